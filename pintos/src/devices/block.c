@@ -3,7 +3,9 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "threads/cont.h"
 #include "threads/malloc.h"
+#include "threads/thread.h"
 
 /* A block device. */
 struct block
@@ -27,7 +29,18 @@ static struct list all_blocks = LIST_INITIALIZER(all_blocks);
 /* The block block assigned to each Pintos role. */
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
+/* Workers for asynchronous requests.  They carry out requests
+   to devices without a submit operation and start requests for
+   drivers that need a thread to do so.  An IDE channel handles
+   one request at a time, so one worker per channel keeps both
+   channels busy. */
+#define BLOCK_IO_WORKERS 2
+static struct workqueue block_wq;
+static bool block_wq_started;
+
 static struct block *list_elem_to_block(struct list_elem *);
+static void block_submit(struct block_io *);
+static work_func block_io_work;
 
 /* Returns a human-readable name for the given block device
    TYPE. */
@@ -137,6 +150,100 @@ void block_write(struct block *block, block_sector_t sector, const void *buffer)
     block->write_cnt++;
 }
 
+/* Starts the workers for asynchronous requests.  Must be called
+   after thread_start(). */
+void block_init(void)
+{
+    workqueue_init(&block_wq, "blockio", BLOCK_IO_WORKERS, PRI_DEFAULT,
+                   false);
+    block_wq_started = true;
+}
+
+/* Starts reading sector SECTOR from BLOCK into BUFFER, which
+   must have room for BLOCK_SECTOR_SIZE bytes, and returns
+   without waiting.  Schedules continuation DONE once BUFFER
+   holds the data.  IO describes the request and must remain
+   valid until then.  May be called from an interrupt
+   handler. */
+void block_read_async(struct block *block, block_sector_t sector,
+                      void *buffer, struct block_io *io, struct cont *done)
+{
+    io->block = block;
+    io->sector = sector;
+    io->buffer = buffer;
+    io->write = false;
+    io->done = done;
+    block_submit(io);
+}
+
+/* Starts writing sector SECTOR to BLOCK from BUFFER, which
+   must contain BLOCK_SECTOR_SIZE bytes, and returns without
+   waiting.  Schedules continuation DONE once the block device
+   has acknowledged receiving the data.  IO and BUFFER must
+   remain valid until then.  May be called from an interrupt
+   handler. */
+void block_write_async(struct block *block, block_sector_t sector,
+                       const void *buffer, struct block_io *io,
+                       struct cont *done)
+{
+    io->block = block;
+    io->sector = sector;
+    io->buffer = (void *)buffer;
+    io->write = true;
+    io->done = done;
+    block_submit(io);
+}
+
+/* Hands IO to its device's driver, or if the driver cannot take
+   asynchronous requests, queues it for a worker to carry out. */
+static void
+block_submit(struct block_io *io)
+{
+    struct block *block = io->block;
+
+    ASSERT(block_wq_started);
+    ASSERT(io->done != NULL);
+
+    check_sector(block, io->sector);
+    if (block->ops->submit != NULL)
+    {
+        if (io->write)
+        {
+            ASSERT(block->type != BLOCK_FOREIGN);
+            block->write_cnt++;
+        }
+        else
+            block->read_cnt++;
+        block->ops->submit(block->aux, io);
+        return;
+    }
+    work_init(&io->work, block_io_work, io);
+    workqueue_queue(&block_wq, &io->work);
+}
+
+/* Returns the work queue of the block I/O workers, for drivers
+   whose submit operation needs a thread to start a request. */
+struct workqueue *
+block_workqueue(void)
+{
+    ASSERT(block_wq_started);
+    return &block_wq;
+}
+
+/* Carries out request IO_ on a worker thread, then schedules
+   its continuation. */
+static void
+block_io_work(void *io_)
+{
+    struct block_io *io = io_;
+
+    if (io->write)
+        block_write(io->block, io->sector, io->buffer);
+    else
+        block_read(io->block, io->sector, io->buffer);
+    cont_schedule(io->done);
+}
+
 /* Returns the number of sectors in BLOCK. */
 block_sector_t
 block_size(struct block *block)
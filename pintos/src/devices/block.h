@@ -1,8 +1,10 @@
 #ifndef DEVICES_BLOCK_H
 #define DEVICES_BLOCK_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <inttypes.h>
+#include "threads/cont.h"
 
 /* Size of a block device sector in bytes.
    All IDE disks use this sector size, as do most USB and SCSI
@@ -56,6 +58,31 @@ void block_write(struct block *, block_sector_t, const void *);
 const char *block_name(struct block *);
 enum block_type block_type(struct block *);
 
+/* Asynchronous block device operations.  Any number of
+   requests may be outstanding; each one needs only a struct
+   block_io, which the caller owns until DONE runs.  Requests to
+   a device whose driver supports them wait for the device
+   without a thread and complete from its interrupt; others are
+   carried out one at a time by a block I/O worker. */
+struct block_io
+{
+    struct block *block;   /* Block device. */
+    block_sector_t sector; /* Sector to read or write. */
+    void *buffer;          /* BLOCK_SECTOR_SIZE bytes of data. */
+    bool write;            /* Write, or else read? */
+    struct cont *done;     /* Scheduled when the request is done. */
+    void *aux;             /* Driver's data for the request. */
+    struct cont start;     /* Driver's continuation to start it. */
+    struct work work;      /* Carries out the request, if the driver
+                              has no submit operation. */
+};
+
+void block_init(void);
+void block_read_async(struct block *, block_sector_t, void *,
+                      struct block_io *, struct cont *done);
+void block_write_async(struct block *, block_sector_t, const void *,
+                       struct block_io *, struct cont *done);
+
 /* Statistics. */
 void block_print_stats(void);
 
@@ -65,8 +92,15 @@ struct block_operations
 {
     void (*read)(void *aux, block_sector_t, void *buffer);
     void (*write)(void *aux, block_sector_t, const void *buffer);
+
+    /* Optional.  Starts the request in the block_io and returns
+       without waiting; schedules its DONE continuation once it
+       completes. */
+    void (*submit)(void *aux, struct block_io *);
 };
 
+struct workqueue *block_workqueue(void);
+
 struct block *block_register(const char *name, enum block_type,
                              const char *extra_info, block_sector_t size,
                              const struct block_operations *, void *aux);
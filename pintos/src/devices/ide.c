@@ -6,9 +6,11 @@
 #include "devices/block.h"
 #include "devices/partition.h"
 #include "devices/timer.h"
+#include "threads/cont.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -57,6 +59,8 @@ struct ata_disk
     struct channel *channel; /* Channel that disk is attached to. */
     int dev_no;              /* Device 0 or 1 for master or slave. */
     bool is_ata;             /* Is device an ATA disk? */
+    block_sector_t capacity; /* Size in sectors, if is_ata. */
+    char extra_info[128];    /* Model and serial number, if is_ata. */
 };
 
 /* An ATA channel (aka controller).
@@ -67,10 +71,12 @@ struct channel
     uint16_t reg_base; /* Base I/O port. */
     uint8_t irq;       /* Interrupt in use. */
 
-    struct lock lock;                 /* Must acquire to access the controller. */
+    struct semaphore idle;            /* Must down to access the controller. */
     bool expecting_interrupt;         /* True if an interrupt is expected, false if
                                    any interrupt would be spurious. */
     struct semaphore completion_wait; /* Up'd by interrupt handler. */
+    struct block_io *cur;             /* Asynchronous request in progress. */
+    struct cont complete;             /* Completes CUR. */
 
     struct ata_disk devices[2]; /* The devices on this channel. */
 };
@@ -81,9 +87,14 @@ static struct channel channels[CHANNEL_CNT];
 
 static struct block_operations ide_operations;
 
+/* Upped by each channel's probe thread when it is done. */
+static struct semaphore probe_done;
+
+static thread_func probe_channel;
 static void reset_channel(struct channel *);
 static bool check_device_type(struct ata_disk *);
 static void identify_ata_device(struct ata_disk *);
+static void register_ata_device(struct ata_disk *);
 
 static void select_sector(struct ata_disk *, block_sector_t);
 static void issue_pio_command(struct channel *, uint8_t command);
@@ -95,13 +106,20 @@ static bool wait_while_busy(const struct ata_disk *);
 static void select_device(const struct ata_disk *);
 static void select_device_wait(const struct ata_disk *);
 
+static cont_func ide_start;
+static cont_func ide_complete;
+
 static void interrupt_handler(struct intr_frame *);
 
-/* Initialize the disk subsystem and detect disks. */
+/* Initialize the disk subsystem and detect disks.  The channels
+   are reset and probed concurrently, each by a thread of its
+   own, because most of that time is spent waiting for the
+   hardware. */
 void ide_init(void)
 {
     size_t chan_no;
 
+    sema_init(&probe_done, 0);
     for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
     {
         struct channel *c = &channels[chan_no];
@@ -122,9 +140,11 @@ void ide_init(void)
         default:
             NOT_REACHED();
         }
-        lock_init(&c->lock);
+        sema_init(&c->idle, 1);
         c->expecting_interrupt = false;
         sema_init(&c->completion_wait, 0);
+        c->cur = NULL;
+        cont_init(&c->complete, ide_complete, c);
 
         /* Initialize devices. */
         for (dev_no = 0; dev_no < 2; dev_no++)
@@ -140,17 +160,22 @@ void ide_init(void)
         /* Register interrupt handler. */
         intr_register_ext(c->irq, interrupt_handler, c->name);
 
-        /* Reset hardware. */
-        reset_channel(c);
+        /* Probe the channel. */
+        if (thread_create(c->name, PRI_DEFAULT, probe_channel, c) == TID_ERROR)
+            PANIC("can't start probe of %s", c->name);
+    }
 
-        /* Distinguish ATA hard disks from other devices. */
-        if (check_device_type(&c->devices[0]))
-            check_device_type(&c->devices[1]);
+    /* Wait for all the probes, then register the disks in the
+     same order as probing them one after another would. */
+    for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
+        sema_down(&probe_done);
+    for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
+    {
+        int dev_no;
 
-        /* Read hard disk identity information. */
         for (dev_no = 0; dev_no < 2; dev_no++)
-            if (c->devices[dev_no].is_ata)
-                identify_ata_device(&c->devices[dev_no]);
+            if (channels[chan_no].devices[dev_no].is_ata)
+                register_ata_device(&channels[chan_no].devices[dev_no]);
     }
 }
 
@@ -158,6 +183,29 @@ void ide_init(void)
 
 static char *descramble_ata_string(char *, int size);
 
+/* Thread that resets channel C_ and identifies the disks on
+   it. */
+static void
+probe_channel(void *c_)
+{
+    struct channel *c = c_;
+    int dev_no;
+
+    /* Reset hardware. */
+    reset_channel(c);
+
+    /* Distinguish ATA hard disks from other devices. */
+    if (check_device_type(&c->devices[0]))
+        check_device_type(&c->devices[1]);
+
+    /* Read hard disk identity information. */
+    for (dev_no = 0; dev_no < 2; dev_no++)
+        if (c->devices[dev_no].is_ata)
+            identify_ata_device(&c->devices[dev_no]);
+
+    sema_up(&probe_done);
+}
+
 /* Resets an ATA channel and waits for any devices present on it
    to finish the reset. */
 static void
@@ -250,8 +298,7 @@ check_device_type(struct ata_disk *d)
 }
 
 /* Sends an IDENTIFY DEVICE command to disk D and reads the
-   response.  Registers the disk with the block device
-   layer. */
+   response into D. */
 static void
 identify_ata_device(struct ata_disk *d)
 {
@@ -259,8 +306,6 @@ identify_ata_device(struct ata_disk *d)
     char id[BLOCK_SECTOR_SIZE];
     block_sector_t capacity;
     char *model, *serial;
-    char extra_info[128];
-    struct block *block;
 
     ASSERT(d->is_ata);
 
@@ -282,7 +327,7 @@ identify_ata_device(struct ata_disk *d)
     capacity = *(uint32_t *)&id[60 * 2];
     model = descramble_ata_string(&id[10 * 2], 20);
     serial = descramble_ata_string(&id[27 * 2], 40);
-    snprintf(extra_info, sizeof extra_info,
+    snprintf(d->extra_info, sizeof d->extra_info,
              "model \"%s\", serial \"%s\"", model, serial);
 
     /* Disable access to IDE disks over 1 GB, which are likely
@@ -298,9 +343,19 @@ identify_ata_device(struct ata_disk *d)
         d->is_ata = false;
         return;
     }
+    d->capacity = capacity;
+}
+
+/* Registers disk D, identified by identify_ata_device(), with
+   the block device layer, along with its partitions. */
+static void
+register_ata_device(struct ata_disk *d)
+{
+    struct block *block;
+
+    ASSERT(d->is_ata);
 
-    /* Register. */
-    block = block_register(d->name, BLOCK_RAW, extra_info, capacity,
+    block = block_register(d->name, BLOCK_RAW, d->extra_info, d->capacity,
                            &ide_operations, d);
     partition_scan(block);
 }
@@ -342,14 +397,14 @@ ide_read(void *d_, block_sector_t sec_no, void *buffer)
 {
     struct ata_disk *d = d_;
     struct channel *c = d->channel;
-    lock_acquire(&c->lock);
+    sema_down(&c->idle);
     select_sector(d, sec_no);
     issue_pio_command(c, CMD_READ_SECTOR_RETRY);
     sema_down(&c->completion_wait);
     if (!wait_while_busy(d))
         PANIC("%s: disk read failed, sector=%" PRDSNu, d->name, sec_no);
     input_sector(c, buffer);
-    lock_release(&c->lock);
+    sema_up(&c->idle);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -362,20 +417,90 @@ ide_write(void *d_, block_sector_t sec_no, const void *buffer)
 {
     struct ata_disk *d = d_;
     struct channel *c = d->channel;
-    lock_acquire(&c->lock);
+    sema_down(&c->idle);
     select_sector(d, sec_no);
     issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
     if (!wait_while_busy(d))
         PANIC("%s: disk write failed, sector=%" PRDSNu, d->name, sec_no);
     output_sector(c, buffer);
     sema_down(&c->completion_wait);
-    lock_release(&c->lock);
+    sema_up(&c->idle);
+}
+
+/* Starts the request in IO on disk D_ and returns without
+   waiting.  The request waits for the channel without a thread;
+   once it has the channel, a block I/O worker issues the
+   command, and the channel's completion interrupt finishes it. */
+static void
+ide_submit(void *d_, struct block_io *io)
+{
+    struct ata_disk *d = d_;
+
+    io->aux = d;
+    cont_init(&io->start, ide_start, io);
+    cont_set_workqueue(&io->start, block_workqueue());
+    sema_down_async(&d->channel->idle, &io->start);
+}
+
+/* Issues request IO_, which owns its channel, and for a write
+   hands the disk the data.  Runs on a block I/O worker because
+   waiting for the disk to become ready may sleep, but returns
+   without waiting for the request to complete. */
+static void
+ide_start(void *io_)
+{
+    struct block_io *io = io_;
+    struct ata_disk *d = io->aux;
+    struct channel *c = d->channel;
+
+    c->cur = io;
+    select_sector(d, io->sector);
+    if (io->write)
+    {
+        issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
+        if (!wait_while_busy(d))
+            PANIC("%s: disk write failed, sector=%" PRDSNu, d->name,
+                  io->sector);
+        output_sector(c, io->buffer);
+    }
+    else
+        issue_pio_command(c, CMD_READ_SECTOR_RETRY);
+    sema_down_async(&c->completion_wait, &c->complete);
+}
+
+/* Finishes channel C_'s request in progress, at the end of its
+   completion interrupt: reads in the data, if any, gives up the
+   channel, and schedules the request's continuation.  The
+   interrupt means the disk is done being busy, so there is no
+   need to wait for it here. */
+static void
+ide_complete(void *c_)
+{
+    struct channel *c = c_;
+    struct block_io *io = c->cur;
+
+    ASSERT(io != NULL);
+
+    c->cur = NULL;
+    if (!io->write)
+    {
+        if ((inb(reg_alt_status(c)) & (STA_BSY | STA_DRQ)) != STA_DRQ)
+        {
+            struct ata_disk *d = io->aux;
+            PANIC("%s: disk read failed, sector=%" PRDSNu, d->name,
+                  io->sector);
+        }
+        input_sector(c, io->buffer);
+    }
+    sema_up(&c->idle);
+    cont_schedule(io->done);
 }
 
 static struct block_operations ide_operations =
     {
         ide_read,
-        ide_write};
+        ide_write,
+        ide_submit};
 
 /* Selects device D, waiting for it to become ready, and then
    writes SEC_NO to the disk's sector selection registers.  (We
@@ -2,14 +2,23 @@
 #include <debug.h>
 #include "devices/intq.h"
 #include "devices/serial.h"
+#include "threads/synch.h"
+
+static uint8_t take_key(void);
 
 /* Stores keys from the keyboard and serial port. */
 static struct intq buffer;
 
+/* Counts the keys in BUFFER that no reader has claimed yet.
+   Readers wait here rather than in BUFFER, so that a wait for
+   input can be canceled. */
+static struct semaphore keys;
+
 /* Initializes the input buffer. */
 void input_init(void)
 {
     intq_init(&buffer);
+    sema_init(&keys, 0);
 }
 
 /* Adds a key to the input buffer.
@@ -20,6 +29,7 @@ void input_putc(uint8_t key)
     ASSERT(!intq_full(&buffer));
 
     intq_putc(&buffer, key);
+    sema_up(&keys);
     serial_notify();
 }
 
@@ -27,6 +37,26 @@ void input_putc(uint8_t key)
    If the buffer is empty, waits for a key to be pressed. */
 uint8_t
 input_getc(void)
+{
+    sema_down(&keys);
+    return take_key();
+}
+
+/* Like input_getc(), but gives up if sema_cancel() is called
+   for the running thread while it waits.  Stores the key in
+   *KEY and returns true, or returns false if canceled. */
+bool input_getc_cancelable(uint8_t *key)
+{
+    if (!sema_down_cancelable(&keys))
+        return false;
+    *key = take_key();
+    return true;
+}
+
+/* Removes a key that the caller has claimed from KEYS from the
+   input buffer and returns it. */
+static uint8_t
+take_key(void)
 {
     enum intr_level old_level;
     uint8_t key;
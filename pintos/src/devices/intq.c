@@ -87,7 +87,7 @@ wait(struct intq *q UNUSED, struct thread **waiter)
     ASSERT((waiter == &q->not_empty && intq_empty(q)) || (waiter == &q->not_full && intq_full(q)));
 
     *waiter = thread_current();
-    thread_block();
+    thread_block_for(WAIT_IO);
 }
 
 /* WAITER must be the address of Q's not_empty or not_full
@@ -314,7 +314,22 @@ partition_write(void *p_, block_sector_t sector, const void *buffer)
     block_write(p->block, p->start + sector, buffer);
 }
 
+/* Starts the request in IO on partition P_ by passing it on,
+   translated, to the partition's block device. */
+static void
+partition_submit(void *p_, struct block_io *io)
+{
+    struct partition *p = p_;
+    if (io->write)
+        block_write_async(p->block, p->start + io->sector, io->buffer,
+                          io, io->done);
+    else
+        block_read_async(p->block, p->start + io->sector, io->buffer,
+                         io, io->done);
+}
+
 static struct block_operations partition_operations =
     {
         partition_read,
-        partition_write};
+        partition_write,
+        partition_submit};
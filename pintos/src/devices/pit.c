@@ -11,9 +11,6 @@
 #define PIT_PORT_CONTROL 0x43                        /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL)) /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
 
@@ -80,3 +77,59 @@ void pit_configure_channel(int channel, int mode, int frequency)
     outb(PIT_PORT_COUNTER(channel), count >> 8);
     intr_set_level(old_level);
 }
+
+/* Starts a one-shot countdown of COUNT PIT cycles on the given
+   CHANNEL, using mode 0 ("interrupt on terminal count").  The
+   channel's output, and thus interrupt line 0 for channel 0,
+   goes high once when the count runs out and stays high until
+   the channel is reconfigured. */
+void pit_start_oneshot(int channel, uint16_t count)
+{
+    enum intr_level old_level;
+
+    ASSERT(channel == 0 || channel == 2);
+
+    old_level = intr_disable();
+    outb(PIT_PORT_CONTROL, (channel << 6) | 0x30);
+    outb(PIT_PORT_COUNTER(channel), count);
+    outb(PIT_PORT_COUNTER(channel), count >> 8);
+    intr_set_level(old_level);
+}
+
+/* Returns the current value of CHANNEL's down-counter, that is,
+   the number of PIT cycles remaining in the current period. */
+uint16_t pit_read_count(int channel)
+{
+    enum intr_level old_level;
+    uint16_t count;
+
+    ASSERT(channel == 0 || channel == 2);
+
+    /* Latch the counter, then read it low byte first. */
+    old_level = intr_disable();
+    outb(PIT_PORT_CONTROL, channel << 6);
+    count = inb(PIT_PORT_COUNTER(channel));
+    count |= inb(PIT_PORT_COUNTER(channel)) << 8;
+    intr_set_level(old_level);
+
+    return count;
+}
+
+/* Returns true if CHANNEL's output is currently high.  In mode
+   0, this means that a one-shot countdown has run out.  Uses the
+   8254 "read-back" command to latch the channel's status byte,
+   whose top bit is the state of the output pin. */
+bool pit_output_high(int channel)
+{
+    enum intr_level old_level;
+    uint8_t status;
+
+    ASSERT(channel == 0 || channel == 2);
+
+    old_level = intr_disable();
+    outb(PIT_PORT_CONTROL, 0xe0 | (2 << channel));
+    status = inb(PIT_PORT_COUNTER(channel));
+    intr_set_level(old_level);
+
+    return (status & 0x80) != 0;
+}
@@ -1,12 +1,16 @@
 #include "devices/serial.h"
 #include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
 #include "devices/input.h"
-#include "devices/intq.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
 
 /* Register definitions for the 16550A UART used in PCs.
    The 16550A has a lot more going on than shown here, but this
@@ -37,6 +41,13 @@
 #define IER_RECV 0x01 /* Interrupt when data received. */
 #define IER_XMIT 0x02 /* Interrupt when transmit finishes. */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01 /* Enable FIFOs. */
+#define FCR_CLEAR 0x06  /* Clear receive and transmit FIFOs. */
+
+/* Bytes the transmit FIFO holds. */
+#define TX_FIFO_SIZE 16
+
 /* Line Control Register bits. */
 #define LCR_N81 0x03  /* No parity, 8 data bits, 1 stop bit. */
 #define LCR_DLAB 0x80 /* Divisor Latch Access Bit (DLAB). */
@@ -53,11 +64,43 @@ static enum { UNINIT,
               POLL,
               QUEUE } mode;
 
-/* Data to be transmitted. */
-static struct intq txq;
+/* Size of the transmit buffer in kB.  Set by kernel
+   command-line option "-serial-buf=KB". */
+int serial_buf_kb = 16;
+
+/* If true, output that finds the transmit buffer full is
+   dropped.  If false (default), the writer waits for room, or
+   if it cannot sleep, polls bytes out to make room.  Set by
+   kernel command-line option "-serial-drop". */
+bool serial_drop;
+
+/* Data to be transmitted, a ring of tx_size bytes holding
+   tx_len bytes starting at tx_tail.  Filled by writers and
+   drained by the transmit interrupt, a FIFO-full at a time. */
+static uint8_t *tx_buf;
+static size_t tx_size;
+static size_t tx_head; /* New data is written here. */
+static size_t tx_tail; /* Old data is read here. */
+static size_t tx_len;  /* Bytes waiting. */
+
+/* Bytes that serial_write() copies out of its caller's buffer at
+   a time before queuing them in tx_buf. */
+#define TX_STAGE_SIZE 128
+
+/* Writers waiting for room in tx_buf. */
+static struct semaphore tx_room;
+static int tx_waiters;
+
+/* Statistics. */
+static long long tx_cnt;   /* # of bytes buffered. */
+static long long poll_cnt; /* # of bytes polled out to make room. */
+static long long wait_cnt; /* # of times a writer waited for room. */
+static long long drop_cnt; /* # of bytes dropped. */
 
 static void set_serial(int bps);
 static void putc_poll(uint8_t);
+static uint8_t tx_getc(void);
+static void tx_put(const uint8_t *, size_t, enum intr_level);
 static void write_ier(void);
 static intr_handler_func serial_interrupt;
 
@@ -73,7 +116,6 @@ init_poll(void)
     outb(FCR_REG, 0);        /* Disable FIFO. */
     set_serial(9600);        /* 9.6 kbps, N-8-1. */
     outb(MCR_REG, MCR_OUT2); /* Required to enable interrupts. */
-    intq_init(&txq);
     mode = POLL;
 }
 
@@ -87,6 +129,16 @@ void serial_init_queue(void)
     if (mode == UNINIT)
         init_poll();
     ASSERT(mode == POLL);
+    ASSERT(serial_buf_kb > 0);
+
+    tx_size = ROUND_UP(serial_buf_kb * 1024, PGSIZE);
+    tx_buf = palloc_get_multiple(PAL_ASSERT, tx_size / PGSIZE);
+    tx_head = tx_tail = tx_len = 0;
+    sema_init(&tx_room, 0);
+
+    /* Use the 16-byte FIFOs, still interrupting as soon as one
+     byte is received. */
+    outb(FCR_REG, FCR_ENABLE | FCR_CLEAR);
 
     intr_register_ext(0x20 + 4, serial_interrupt, "serial");
     mode = QUEUE;
@@ -98,35 +150,104 @@ void serial_init_queue(void)
 /* Sends BYTE to the serial port. */
 void serial_putc(uint8_t byte)
 {
-    enum intr_level old_level = intr_disable();
+    serial_write(&byte, 1);
+}
+
+/* Sends the SIZE bytes in BUFFER to the serial port. */
+void serial_write(const void *buffer, size_t size)
+{
+    const uint8_t *buf = buffer;
+    enum intr_level old_level;
+
+    if (mode == QUEUE && intr_get_level() == INTR_ON)
+    {
+        /* BUFFER may be in user memory.  Copy it out a chunk at a
+         time with interrupts on, where a page fault is harmless,
+         and only queue the kernel copy with interrupts off. */
+        uint8_t stage[TX_STAGE_SIZE];
 
+        while (size > 0)
+        {
+            size_t chunk = size < sizeof stage ? size : sizeof stage;
+
+            memcpy(stage, buf, chunk);
+            old_level = intr_disable();
+            tx_put(stage, chunk, old_level);
+            intr_set_level(old_level);
+            buf += chunk;
+            size -= chunk;
+        }
+        return;
+    }
+
+    old_level = intr_disable();
     if (mode != QUEUE)
     {
         /* If we're not set up for interrupt-driven I/O yet,
-         use dumb polling to transmit a byte. */
+         use dumb polling to transmit the bytes. */
         if (mode == UNINIT)
             init_poll();
-        putc_poll(byte);
+        while (size-- > 0)
+            putc_poll(*buf++);
     }
     else
+        tx_put(buf, size, old_level);
+    intr_set_level(old_level);
+}
+
+/* Copies the SIZE bytes in BUF into the transmit buffer, as much
+   as fits at a time, and updates the interrupt enable register.
+   OLD_LEVEL is the caller's interrupt level before it turned
+   interrupts off, which decides whether we may sleep for room. */
+static void
+tx_put(const uint8_t *buf, size_t size, enum intr_level old_level)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    while (size > 0)
     {
-        /* Otherwise, queue a byte and update the interrupt enable
-         register. */
-        if (old_level == INTR_OFF && intq_full(&txq))
+        size_t chunk;
+
+        if (tx_len == tx_size)
         {
-            /* Interrupts are off and the transmit queue is full.
-             If we wanted to wait for the queue to empty,
-             we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-            putc_poll(intq_getc(&txq));
+            if (serial_drop)
+            {
+                drop_cnt += size;
+                break;
+            }
+            else if (old_level == INTR_OFF)
+            {
+                /* Interrupts are off and the buffer is full.
+                 If we wanted to wait for the buffer to
+                 empty, we'd have to reenable interrupts.
+                 That's impolite, so we'll send a character
+                 via polling instead. */
+                putc_poll(tx_getc());
+                poll_cnt++;
+            }
+            else
+            {
+                tx_waiters++;
+                wait_cnt++;
+                write_ier();
+                sema_down(&tx_room);
+            }
+            continue;
         }
 
-        intq_putc(&txq, byte);
-        write_ier();
+        chunk = tx_size - tx_len;
+        if (chunk > tx_size - tx_head)
+            chunk = tx_size - tx_head;
+        if (chunk > size)
+            chunk = size;
+        memcpy(tx_buf + tx_head, buf, chunk);
+        tx_head = (tx_head + chunk) % tx_size;
+        tx_len += chunk;
+        tx_cnt += chunk;
+        buf += chunk;
+        size -= chunk;
     }
-
-    intr_set_level(old_level);
+    write_ier();
 }
 
 /* Flushes anything in the serial buffer out the port in polling
@@ -134,11 +255,21 @@ void serial_putc(uint8_t byte)
 void serial_flush(void)
 {
     enum intr_level old_level = intr_disable();
-    while (!intq_empty(&txq))
-        putc_poll(intq_getc(&txq));
+    while (tx_len > 0)
+        putc_poll(tx_getc());
     intr_set_level(old_level);
 }
 
+/* Prints serial port statistics. */
+void serial_print_stats(void)
+{
+    if (mode != QUEUE)
+        return;
+    printf("Serial: %lld bytes through %zu-byte buffer, %lld polled, "
+           "%lld waits, %lld dropped\n",
+           tx_cnt, tx_size, poll_cnt, wait_cnt, drop_cnt);
+}
+
 /* The fullness of the input buffer may have changed.  Reassess
    whether we should block receive interrupts.
    Called by the input buffer routines when characters are added
@@ -180,7 +311,7 @@ write_ier(void)
 
     /* Enable transmit interrupt if we have any characters to
      transmit. */
-    if (!intq_empty(&txq))
+    if (tx_len > 0)
         ier |= IER_XMIT;
 
     /* Enable receive interrupt if we have room to store any
@@ -203,6 +334,22 @@ putc_poll(uint8_t byte)
     outb(THR_REG, byte);
 }
 
+/* Removes and returns the oldest byte in the transmit buffer,
+   which must not be empty. */
+static uint8_t
+tx_getc(void)
+{
+    uint8_t byte;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(tx_len > 0);
+
+    byte = tx_buf[tx_tail];
+    tx_tail = (tx_tail + 1) % tx_size;
+    tx_len--;
+    return byte;
+}
+
 /* Serial interrupt handler. */
 static void
 serial_interrupt(struct intr_frame *f UNUSED)
@@ -216,10 +363,21 @@ serial_interrupt(struct intr_frame *f UNUSED)
     while (!input_full() && (inb(LSR_REG) & LSR_DR) != 0)
         input_putc(inb(RBR_REG));
 
-    /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
-    while (!intq_empty(&txq) && (inb(LSR_REG) & LSR_THRE) != 0)
-        outb(THR_REG, intq_getc(&txq));
+    /* If we have bytes to transmit and the transmit FIFO is
+     empty, fill it. */
+    if (tx_len > 0 && (inb(LSR_REG) & LSR_THRE) != 0)
+    {
+        int i;
+
+        for (i = 0; i < TX_FIFO_SIZE && tx_len > 0; i++)
+            outb(THR_REG, tx_getc());
+    }
+
+    /* Wake up waiting writers once half the buffer is free, so
+     that each refills it in large pieces. */
+    if (tx_waiters > 0 && tx_len <= tx_size / 2)
+        for (; tx_waiters > 0; tx_waiters--)
+            sema_up(&tx_room);
 
     /* Update interrupt enable register based on queue status. */
     write_ier();
@@ -4,8 +4,13 @@
 #include "devices/kbd.h"
 #include "devices/serial.h"
 #include "devices/timer.h"
+#include "threads/fpu.h"
+#include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/klog.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
@@ -90,6 +95,7 @@ void shutdown_power_off(void)
     filesys_done();
 #endif
 
+    klog_flush();
     print_stats();
 
     printf("Powering off...\n");
@@ -130,10 +136,18 @@ print_stats(void)
 {
     timer_print_stats();
     thread_print_stats();
+    workqueue_print_stats();
+    intr_print_stats();
+    fpu_print_stats();
+#ifdef LOCK_STAT
+    lock_print_stats();
+#endif
 #ifdef FILESYS
     block_print_stats();
 #endif
     console_print_stats();
+    klog_print_stats();
+    serial_print_stats();
     kbd_print_stats();
 #ifdef USERPROG
     exception_print_stats();
@@ -7,6 +7,7 @@
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/tsc.h"
 #include <list.h>
 
 /* See [8254] for hardware details of the 8254 timer chip. */
@@ -21,51 +22,162 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
-/* Number of loops per timer tick.
-   Initialized by timer_calibrate(). */
-static unsigned loops_per_tick;
+/* Number of timer interrupts taken since OS booted.  Equal to
+   ticks unless the timer is tickless. */
+static int64_t timer_interrupts;
+
+/* See the declaration in timer.h. */
+bool timer_tickless;
+
+/* See the declaration in timer.h. */
+int timer_tsc_khz;
+
+/* PIT cycles per timer tick. */
+#define TICK_CYCLES ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Nanoseconds per timer tick. */
+#define NS_PER_TICK (1000000000 / TIMER_FREQ)
+
+/* Number of PIT cycles over which to count TSC cycles in
+   timer_calibrate().  Interrupts are off meanwhile, so this is
+   kept under a tick, lest one be lost. */
+#define CALIBRATE_CYCLES (TICK_CYCLES / 2)
+
+/* Maximum number of ticks that one PIT one-shot countdown can
+   span, given that it may start up to a tick before the first
+   tick boundary and the PIT counter has only 16 bits.  About 5
+   at 100 Hz. */
+#define ONESHOT_MAX_TICKS ((UINT16_MAX - TICK_CYCLES) / TICK_CYCLES + 1)
+
+/* Tickless idle state.  While the CPU is idle in tickless mode,
+   the PIT runs a one-shot countdown that ends on the tick
+   boundary ONESHOT_TICKS ticks in the future, instead of
+   interrupting on every tick.  ONESHOT_TICKS is 0 while the PIT
+   is in its normal periodic mode. */
+static int oneshot_ticks;    /* Ticks spanned by the countdown. */
+static uint16_t oneshot_len; /* Length of the countdown, in cycles. */
+static uint16_t oneshot_lead; /* Cycles to the first tick boundary. */
+
+/* Time-stamp counter, the clock behind timer_now_ns(), which
+   counts CPU cycles.  TSC_HZ is its frequency, measured against
+   the PIT by timer_calibrate(), or 0 before then.  TSC_BASE is
+   its estimated value at tick 0, and NS_PER_CYCLE the length of
+   a cycle in ns, as a 32.32 fixed-point number. */
+static uint64_t tsc_hz;
+static uint64_t tsc_base;
+static uint64_t ns_per_cycle;
+
+/* High-resolution timers.
+
+   Pending hrtimers are kept in a list sorted by deadline.  When
+   the earliest deadline falls before the next tick boundary, the
+   PIT is switched to a one-shot countdown that ends at the
+   deadline.  Its interrupt fires the hrtimers that are due, then
+   counts down the HR_REST cycles left to the tick boundary,
+   where the tickless-mode code above resumes periodic ticking.
+   Deadlines past the next tick boundary wait for the interrupt
+   of the tick before them.
+
+   The list is shared with the timer interrupt, so it may only be
+   accessed with interrupts off. */
+static struct list hrtimers;
+static bool hr_active;    /* Countdown to an hrtimer running? */
+static uint16_t hr_rest;  /* Cycles from its end to the tick. */
+static int64_t hr_interrupts; /* # of countdowns to an hrtimer. */
+
+/* Shortest countdown to an hrtimer, in PIT cycles. */
+#define HR_MIN_CYCLES 2
+
+/* Hierarchical timer wheel holding pending timeouts.
+
+   Level 0 has one slot per tick for the next 256 ticks.  Each
+   slot of level L > 0 covers 256**L ticks, so the four levels
+   together reach 2**32 ticks into the future.  A timeout goes
+   into the lowest level whose range covers its deadline, in the
+   slot selected by the corresponding 8 bits of the deadline.
+   Whenever the level-L index wraps around to 0, the current
+   slot of level L + 1 is "cascaded," that is, its timeouts are
+   reinserted into lower levels.  Thus, arming and cancelling a
+   timeout take constant time, and each timer interrupt only has
+   to look at the current level-0 slot, plus an occasional
+   cascade.
+
+   The wheel is shared with the timer interrupt, so it may only
+   be accessed with interrupts off. */
+#define WHEEL_LEVELS 4
+#define WHEEL_BITS 8
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+static struct list wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+
+/* Next tick whose level-0 slot has yet to be processed. */
+static int64_t wheel_next;
 
 static intr_handler_func timer_interrupt;
-static bool too_many_loops(unsigned loops);
-static void busy_wait(int64_t loops);
+static uint64_t measure_tick_cycles(void);
+static uint64_t mul_shift32(uint64_t, uint64_t);
 static void real_time_sleep(int64_t num, int32_t denom);
 static void real_time_delay(int64_t num, int32_t denom);
-static list_less_func less_wake_ticks;
+static void wheel_insert(struct timeout *);
+static void wheel_cascade(int level, int64_t tick);
+static void wheel_advance(void);
+static int wheel_idle_ticks(int max_ticks);
+static void hr_advance(void);
+static void hr_program(void);
+static int hr_idle_ticks(int max_ticks);
+static list_less_func hrtimer_less;
+static void hr_sleep(uint64_t ns);
+static timeout_func wake_sleeper;
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    registers the corresponding interrupt, and initializes the
-   sleep list. */
+   timer wheel and the list of hrtimers. */
 void timer_init(void)
 {
+    int level, slot;
+
+    for (level = 0; level < WHEEL_LEVELS; level++)
+        for (slot = 0; slot < WHEEL_SLOTS; slot++)
+            list_init(&wheel[level][slot]);
+    wheel_next = ticks + 1;
+    list_init(&hrtimers);
+
     pit_configure_channel(0, 2, TIMER_FREQ);
     intr_register_ext(0x20, timer_interrupt, "8254 Timer");
-    list_init(get_sleep_list());
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates the time-stamp counter against the timer, for
+   timer_now_ns(), high-resolution timers, and brief delays.
+   Takes the TSC frequency from timer_tsc_khz if it is set. */
 void timer_calibrate(void)
 {
-    unsigned high_bit, test_bit;
+    int64_t start;
+    uint64_t start_tsc, tick_cycles;
 
     ASSERT(intr_get_level() == INTR_ON);
-    printf("Calibrating timer...  ");
+    if (timer_tsc_khz <= 0)
+        printf("Calibrating timer...  ");
 
-    /* Approximate loops_per_tick as the largest power-of-two
-     still less than one timer tick. */
-    loops_per_tick = 1u << 10;
-    while (!too_many_loops(loops_per_tick << 1))
-    {
-        loops_per_tick <<= 1;
-        ASSERT(loops_per_tick != 0);
-    }
+    /* Start right after a tick, which also leaves the PIT
+     ticking periodically. */
+    start = ticks;
+    while (ticks == start)
+        barrier();
+    start_tsc = rdtsc();
+    start = ticks;
+
+    if (timer_tsc_khz > 0)
+        tick_cycles = (uint64_t)timer_tsc_khz * 1000 / TIMER_FREQ;
+    else
+        tick_cycles = measure_tick_cycles();
 
-    /* Refine the next 8 bits of loops_per_tick. */
-    high_bit = loops_per_tick;
-    for (test_bit = high_bit >> 1; test_bit != high_bit >> 10; test_bit >>= 1)
-        if (!too_many_loops(loops_per_tick | test_bit))
-            loops_per_tick |= test_bit;
+    tsc_base = start_tsc - tick_cycles * start;
+    ns_per_cycle = ((uint64_t)NS_PER_TICK << 32) / tick_cycles;
+    barrier();
+    tsc_hz = tick_cycles * TIMER_FREQ;
 
-    printf("%'" PRIu64 " loops/s.\n", (uint64_t)loops_per_tick * TIMER_FREQ);
+    if (timer_tsc_khz <= 0)
+        printf("%'" PRIu64 " kHz TSC.\n", tsc_hz / 1000);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -86,20 +198,154 @@ timer_elapsed(int64_t then)
     return timer_ticks() - then;
 }
 
+/* Returns the number of nanoseconds since the OS booted, as
+   counted by the time-stamp counter.  Before timer_calibrate(),
+   only has the resolution of a tick. */
+uint64_t
+timer_now_ns(void)
+{
+    if (tsc_hz == 0)
+        return timer_ticks() * NS_PER_TICK;
+    return timer_tsc_to_ns(rdtsc() - tsc_base);
+}
+
+/* Converts CYCLES of the time-stamp counter into nanoseconds.
+   Returns 0 before timer_calibrate(). */
+uint64_t
+timer_tsc_to_ns(uint64_t cycles)
+{
+    return mul_shift32(cycles, ns_per_cycle);
+}
+
+/* Initializes TIMEOUT to call FUNC(AUX) when it expires.  The
+   timeout is not armed. */
+void timeout_init(struct timeout *timeout, timeout_func *func, void *aux)
+{
+    ASSERT(timeout != NULL);
+    ASSERT(func != NULL);
+
+    timeout->deadline = 0;
+    timeout->func = func;
+    timeout->aux = aux;
+    timeout->pending = false;
+}
+
+/* Arms TIMEOUT to expire at the timer interrupt for tick
+   DEADLINE, or at the next timer interrupt if DEADLINE has
+   already passed.  TIMEOUT must not already be pending. */
+void timeout_arm(struct timeout *timeout, int64_t deadline)
+{
+    enum intr_level old_level;
+
+    ASSERT(timeout != NULL);
+
+    old_level = intr_disable();
+    ASSERT(!timeout->pending);
+    timeout->deadline = deadline;
+    timeout->pending = true;
+    wheel_insert(timeout);
+
+    /* An interrupt handler may arm a timeout while the CPU is
+       idle; go back to ticking so that it is not missed. */
+    timer_idle_exit();
+    intr_set_level(old_level);
+}
+
+/* Disarms TIMEOUT.  Returns true if it was pending, false if it
+   had already expired or was never armed. */
+bool timeout_cancel(struct timeout *timeout)
+{
+    enum intr_level old_level;
+    bool was_pending;
+
+    ASSERT(timeout != NULL);
+
+    old_level = intr_disable();
+    was_pending = timeout->pending;
+    if (was_pending)
+    {
+        list_remove(&timeout->elem);
+        timeout->pending = false;
+    }
+    intr_set_level(old_level);
+
+    return was_pending;
+}
+
+/* Initializes TIMER to call FUNC(AUX) when it expires.  The
+   timer is not armed. */
+void hrtimer_init(struct hrtimer *timer, timeout_func *func, void *aux)
+{
+    ASSERT(timer != NULL);
+    ASSERT(func != NULL);
+
+    timer->deadline = 0;
+    timer->func = func;
+    timer->aux = aux;
+    timer->pending = false;
+}
+
+/* Arms TIMER to expire at time DEADLINE, in ns as returned by
+   timer_now_ns(), or as soon as possible if DEADLINE has already
+   passed.  TIMER must not already be pending. */
+void hrtimer_arm(struct hrtimer *timer, uint64_t deadline)
+{
+    enum intr_level old_level;
+
+    ASSERT(timer != NULL);
+
+    old_level = intr_disable();
+    ASSERT(!timer->pending);
+    timer->deadline = deadline;
+    timer->pending = true;
+    list_insert_ordered(&hrtimers, &timer->elem, hrtimer_less, NULL);
+
+    /* Bring a tickless countdown back to the next tick boundary,
+       so that there is a tick to count down to. */
+    timer_idle_exit();
+    hr_program();
+    intr_set_level(old_level);
+}
+
+/* Disarms TIMER.  Returns true if it was pending, false if it
+   had already expired or was never armed. */
+bool hrtimer_cancel(struct hrtimer *timer)
+{
+    enum intr_level old_level;
+    bool was_pending;
+
+    ASSERT(timer != NULL);
+
+    old_level = intr_disable();
+    was_pending = timer->pending;
+    if (was_pending)
+    {
+        list_remove(&timer->elem);
+        timer->pending = false;
+    }
+    intr_set_level(old_level);
+
+    return was_pending;
+}
+
 /* Sleeps for approximately TICKS timer ticks. The current
    thread is put to sleep and wakes up later in
    timer_interrupt(). Interrupts must be turned on. */
 void timer_sleep(int64_t ticks)
 {
     int64_t start = timer_ticks();
+    struct timeout timeout;
+    enum intr_level old_level;
 
     ASSERT(intr_get_level() == INTR_ON);
 
-    enum intr_level old_level = intr_disable();
-    struct thread *cur = thread_current();
-    cur->wake_ticks = start + ticks;
-    list_insert_ordered(get_sleep_list(), &cur->elem, less_wake_ticks, NULL);
-    thread_block();
+    if (ticks <= 0)
+        return;
+
+    timeout_init(&timeout, wake_sleeper, thread_current());
+    old_level = intr_disable();
+    timeout_arm(&timeout, start + ticks);
+    thread_block_for(WAIT_SLEEP);
     intr_set_level(old_level);
 }
 
@@ -160,67 +406,380 @@ void timer_ndelay(int64_t ns)
     real_time_delay(ns, 1000 * 1000 * 1000);
 }
 
+/* Called by the idle thread, with interrupts off, just before
+   it halts the CPU.  In tickless mode, replaces the periodic
+   timer interrupt by a single interrupt at the next tick on
+   which the timer wheel has work to do, or as far ahead as the
+   PIT allows. */
+void timer_idle_enter(void)
+{
+    int idle_ticks;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (!timer_tickless || oneshot_ticks != 0)
+        return;
+
+    idle_ticks = wheel_idle_ticks(hr_idle_ticks(ONESHOT_MAX_TICKS - 1));
+    if (idle_ticks == 0)
+        return;
+
+    /* Keep the tick boundaries where they would have been, by
+       counting down the rest of the current period first. */
+    oneshot_ticks = idle_ticks + 1;
+    oneshot_lead = pit_read_count(0);
+    oneshot_len = oneshot_lead + idle_ticks * TICK_CYCLES;
+    pit_start_oneshot(0, oneshot_len);
+}
+
+/* Called, with interrupts off, when the CPU stops being idle.
+   If a one-shot countdown is still running, shortens it to end
+   at the next tick boundary, so that periodic ticking resumes
+   from there. */
+void timer_idle_exit(void)
+{
+    uint16_t elapsed, remaining;
+    int boundaries, passed;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    /* Nothing to do if the PIT is ticking, counting down to an
+       hrtimer before the next tick boundary, or if the countdown
+       ran out and its interrupt is about to be delivered. */
+    if (oneshot_ticks == 0 || hr_active || pit_output_high(0))
+        return;
+
+    /* Count the tick boundaries in the countdown and those
+       already passed. */
+    elapsed = oneshot_len - pit_read_count(0);
+    boundaries = 1 + (oneshot_len - oneshot_lead) / TICK_CYCLES;
+    passed = elapsed < oneshot_lead
+                 ? 0
+                 : 1 + (elapsed - oneshot_lead) / TICK_CYCLES;
+    if (passed + 1 >= boundaries)
+        return;
+
+    remaining = oneshot_lead + passed * TICK_CYCLES - elapsed;
+    oneshot_ticks -= boundaries - (passed + 1);
+    oneshot_len = oneshot_lead = remaining;
+    pit_start_oneshot(0, remaining);
+}
+
 /* Prints timer statistics. */
 void timer_print_stats(void)
 {
     printf("Timer: %" PRId64 " ticks\n", timer_ticks());
+    if (timer_tickless)
+        printf("Timer: %" PRId64 " interrupts in tickless mode\n",
+               timer_interrupts);
+    if (hr_interrupts != 0)
+        printf("Timer: %" PRId64 " high-resolution timer interrupts\n",
+               hr_interrupts);
 }
 
-/* Timer interrupt handler. Checks whether there is
-   any thread that can wake up in sleep list. */
+/* Timer interrupt handler. Fires the timeouts and hrtimers that
+   have expired. */
 static void
 timer_interrupt(struct intr_frame *args UNUSED)
 {
+    timer_interrupts++;
+
+    /* If a countdown to an hrtimer ran out, count down the rest of
+       the tick, less the cycles since the countdown ended, and
+       fire the hrtimers.  A periodic interrupt that was already
+       pending when the countdown started is an ordinary tick. */
+    if (hr_active && pit_output_high(0))
+    {
+        uint16_t overshoot = -pit_read_count(0);
+
+        hr_active = false;
+        hr_interrupts++;
+        oneshot_len = oneshot_lead = overshoot < hr_rest
+                                         ? hr_rest - overshoot
+                                         : 1;
+        pit_start_oneshot(0, oneshot_len);
+        hr_advance();
+        return;
+    }
+
+    /* If a one-shot countdown ran out, account for the ticks that
+       passed without an interrupt and resume periodic ticking.
+       A periodic interrupt that was already pending when the
+       countdown started does not count. */
+    if (oneshot_ticks != 0 && pit_output_high(0))
+    {
+        int skipped = oneshot_ticks - 1;
+
+        oneshot_ticks = 0;
+        pit_configure_channel(0, 2, TIMER_FREQ);
+        ticks += skipped;
+        thread_skip_ticks(skipped);
+    }
+
     ticks++;
     thread_tick();
+    wheel_advance();
+    hr_advance();
+}
 
-    struct list *sleep_list = get_sleep_list();
-    while (!list_empty(sleep_list))
+/* Puts TIMEOUT into the timer wheel slot for its deadline.
+   Interrupts must be off. */
+static void
+wheel_insert(struct timeout *timeout)
+{
+    int64_t deadline = timeout->deadline;
+    int64_t delta = deadline - wheel_next;
+    int level;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (delta < 0)
+    {
+        /* Already expired: fire at the next slot processed. */
+        deadline = wheel_next;
+        delta = 0;
+    }
+    else if (delta >= (int64_t)1 << (WHEEL_LEVELS * WHEEL_BITS))
+    {
+        /* Too far in the future: park in the farthest slot.  It
+           will be reinserted, with its real deadline, when that
+           slot is cascaded. */
+        delta = ((int64_t)1 << (WHEEL_LEVELS * WHEEL_BITS)) - 1;
+        deadline = wheel_next + delta;
+    }
+
+    for (level = 0; level < WHEEL_LEVELS - 1; level++)
+        if (delta < (int64_t)1 << ((level + 1) * WHEEL_BITS))
+            break;
+
+    list_push_back(&wheel[level][(deadline >> (level * WHEEL_BITS)) & WHEEL_MASK],
+                   &timeout->elem);
+}
+
+/* Moves the timeouts in the slot of the given LEVEL that covers
+   TICK into lower levels. */
+static void
+wheel_cascade(int level, int64_t tick)
+{
+    struct list *slot = &wheel[level][(tick >> (level * WHEEL_BITS)) & WHEEL_MASK];
+
+    while (!list_empty(slot))
+        wheel_insert(list_entry(list_pop_front(slot), struct timeout, elem));
+}
+
+/* Processes the level-0 slots of every tick up to and including
+   the current one, firing the timeouts in them.  Called from the
+   timer interrupt. */
+static void
+wheel_advance(void)
+{
+    while (wheel_next <= ticks)
     {
-        struct list_elem *e = list_front(sleep_list);
-        struct thread *t = list_entry(e, struct thread, elem);
+        int64_t tick = wheel_next;
+        struct list *slot = &wheel[0][tick & WHEEL_MASK];
+        int level;
+
+        /* When an index wraps around, bring down the timeouts
+           for the next stretch of time from the level above. */
+        for (level = 1; level < WHEEL_LEVELS; level++)
+        {
+            if (((tick >> ((level - 1) * WHEEL_BITS)) & WHEEL_MASK) != 0)
+                break;
+            wheel_cascade(level, tick);
+        }
 
-        if (t->wake_ticks <= ticks)
+        wheel_next++;
+        while (!list_empty(slot))
         {
-            list_pop_front(sleep_list);
-            thread_unblock(t);
+            struct timeout *timeout = list_entry(list_pop_front(slot),
+                                                 struct timeout, elem);
+
+            timeout->pending = false;
+            timeout->func(timeout->aux);
         }
-        else
+    }
+}
+
+/* Returns the number of ticks, up to MAX_TICKS, starting from
+   the next one, for which the timer wheel has no timeouts to
+   fire and nothing to cascade. */
+static int
+wheel_idle_ticks(int max_ticks)
+{
+    int64_t tick;
+
+    for (tick = wheel_next; tick < wheel_next + max_ticks; tick++)
+        if ((tick & WHEEL_MASK) == 0 || !list_empty(&wheel[0][tick & WHEEL_MASK]))
+            break;
+    return tick - wheel_next;
+}
+
+/* Fires the hrtimers that are due, then starts a countdown to
+   the next one if it falls before the next tick boundary.
+   Called from the timer interrupt. */
+static void
+hr_advance(void)
+{
+    uint64_t now = timer_now_ns();
+
+    while (!list_empty(&hrtimers))
+    {
+        struct hrtimer *timer = list_entry(list_front(&hrtimers),
+                                           struct hrtimer, elem);
+
+        if (timer->deadline > now)
             break;
+        list_pop_front(&hrtimers);
+        timer->pending = false;
+        timer->func(timer->aux);
     }
+    hr_program();
 }
 
-/* Returns true if LOOPS iterations waits for more than one timer
-   tick, otherwise false. */
+/* If the earliest hrtimer is due before the next tick boundary,
+   and before the end of any countdown to an hrtimer already
+   running, starts a countdown to it.  Interrupts must be off. */
+static void
+hr_program(void)
+{
+    struct hrtimer *timer;
+    unsigned left, to_tick, count;
+    uint64_t now, delta;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    /* Leave it to the interrupt of a countdown that ran out. */
+    if (list_empty(&hrtimers) || (oneshot_ticks != 0 && pit_output_high(0)))
+        return;
+
+    left = pit_read_count(0);
+    to_tick = hr_active ? left + hr_rest : left;
+    if (to_tick > TICK_CYCLES)
+    {
+        /* Tickless countdown over several ticks. */
+        return;
+    }
+
+    timer = list_entry(list_front(&hrtimers), struct hrtimer, elem);
+    now = timer_now_ns();
+    delta = timer->deadline > now ? timer->deadline - now : 0;
+    if (delta >= NS_PER_TICK)
+        return;
+    count = DIV_ROUND_UP(delta * PIT_HZ, 1000000000);
+    if (count < HR_MIN_CYCLES)
+        count = HR_MIN_CYCLES;
+    if (count >= to_tick || (hr_active && count >= left))
+        return;
+
+    /* Count the tick at the boundary, unless a tickless
+       countdown already does. */
+    if (oneshot_ticks == 0)
+        oneshot_ticks = 1;
+    hr_active = true;
+    hr_rest = to_tick - count;
+    pit_start_oneshot(0, count);
+}
+
+/* Returns MAX_TICKS, or fewer if the PIT must resume ticking
+   sooner for the earliest hrtimer's countdown to start by the
+   tick before it. */
+static int
+hr_idle_ticks(int max_ticks)
+{
+    const struct hrtimer *timer;
+    uint64_t now;
+    int64_t hr_ticks;
+
+    if (list_empty(&hrtimers))
+        return max_ticks;
+
+    /* The countdown starts up to a tick before the first tick
+       boundary, so stop a tick short. */
+    timer = list_entry(list_front(&hrtimers), struct hrtimer, elem);
+    now = timer_now_ns();
+    hr_ticks = timer->deadline > now
+                   ? (int64_t)((timer->deadline - now) / NS_PER_TICK) - 1
+                   : 0;
+    if (hr_ticks < 0)
+        hr_ticks = 0;
+    return hr_ticks < max_ticks ? hr_ticks : max_ticks;
+}
+
+/* Orders hrtimers by deadline. */
 static bool
-too_many_loops(unsigned loops)
+hrtimer_less(const struct list_elem *a_, const struct list_elem *b_,
+             void *aux UNUSED)
 {
-    /* Wait for a timer tick. */
-    int64_t start = ticks;
-    while (ticks == start)
-        barrier();
+    const struct hrtimer *a = list_entry(a_, struct hrtimer, elem);
+    const struct hrtimer *b = list_entry(b_, struct hrtimer, elem);
 
-    /* Run LOOPS loops. */
-    start = ticks;
-    busy_wait(loops);
+    return a->deadline < b->deadline;
+}
 
-    /* If the tick count changed, we iterated too long. */
-    barrier();
-    return start != ticks;
+/* Sleeps for NS nanoseconds on a high-resolution timer.
+   Interrupts must be turned on. */
+static void
+hr_sleep(uint64_t ns)
+{
+    struct hrtimer timer;
+    enum intr_level old_level;
+
+    ASSERT(intr_get_level() == INTR_ON);
+
+    hrtimer_init(&timer, wake_sleeper, thread_current());
+    old_level = intr_disable();
+    hrtimer_arm(&timer, timer_now_ns() + ns);
+    thread_block_for(WAIT_SLEEP);
+    intr_set_level(old_level);
 }
 
-/* Iterates through a simple loop LOOPS times, for implementing
-   brief delays.
+/* Timeout function for timer_sleep(): wakes up thread T_. */
+static void
+wake_sleeper(void *t_)
+{
+    thread_unblock(t_);
+}
 
-   Marked NO_INLINE because code alignment can significantly
-   affect timings, so that if this function was inlined
-   differently in different places the results would be difficult
-   to predict. */
-static void NO_INLINE
-busy_wait(int64_t loops)
+/* Returns the number of TSC cycles per timer tick, counted over
+   CALIBRATE_CYCLES cycles of the PIT, which must be ticking
+   periodically. */
+static uint64_t
+measure_tick_cycles(void)
 {
-    while (loops-- > 0)
-        barrier();
+    enum intr_level old_level;
+    unsigned elapsed = 0;
+    uint16_t prev, cur;
+    uint64_t start, cycles;
+
+    /* With interrupts off, nothing can come between two readings
+     of the PIT for longer than a period, so each difference
+     between readings is unambiguous. */
+    old_level = intr_disable();
+    prev = pit_read_count(0);
+    start = rdtsc();
+    while (elapsed < CALIBRATE_CYCLES)
+    {
+        /* The counter runs down from TICK_CYCLES and reloads. */
+        cur = pit_read_count(0);
+        elapsed += cur <= prev ? prev - cur : prev + TICK_CYCLES - cur;
+        prev = cur;
+    }
+    cycles = rdtsc() - start;
+    intr_set_level(old_level);
+
+    return cycles * TICK_CYCLES / elapsed;
+}
+
+/* Returns (A * B) >> 32, without overflow as long as the result
+   fits in 64 bits. */
+static uint64_t
+mul_shift32(uint64_t a, uint64_t b)
+{
+    uint64_t a_hi = a >> 32, a_lo = (uint32_t)a;
+    uint64_t b_hi = b >> 32, b_lo = (uint32_t)b;
+
+    return ((a_hi * b_hi) << 32) + a_hi * b_lo + a_lo * b_hi
+           + ((a_lo * b_lo) >> 32);
 }
 
 /* Sleep for approximately NUM/DENOM seconds. */
@@ -236,6 +795,7 @@ real_time_sleep(int64_t num, int32_t denom)
     int64_t ticks = num * TIMER_FREQ / denom;
 
     ASSERT(intr_get_level() == INTR_ON);
+    ASSERT(1000000000 % denom == 0);
     if (ticks > 0)
     {
         /* We're waiting for at least one full timer tick.  Use
@@ -243,11 +803,11 @@ real_time_sleep(int64_t num, int32_t denom)
          processes. */
         timer_sleep(ticks);
     }
-    else
+    else if (num > 0)
     {
-        /* Otherwise, use a busy-wait loop for more accurate
-         sub-tick timing. */
-        real_time_delay(num, denom);
+        /* Otherwise, use a high-resolution timer for more
+         accurate sub-tick timing, still yielding the CPU. */
+        hr_sleep(num * (1000000000 / denom));
     }
 }
 
@@ -255,19 +815,16 @@ real_time_sleep(int64_t num, int32_t denom)
 static void
 real_time_delay(int64_t num, int32_t denom)
 {
+    uint64_t start = rdtsc();
+    uint64_t cycles;
+
+    if (num <= 0)
+        return;
+
     /* Scale the numerator and denominator down by 1000 to avoid
      the possibility of overflow. */
     ASSERT(denom % 1000 == 0);
-    busy_wait(loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
-}
-
-/* Compares wake_ticks of two list elements A and B.
-   Returns true if A is less than B, or false if A is
-   greater than or equal to B. */
-static bool
-less_wake_ticks(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
-{
-    const struct thread *a_t = list_entry(a, struct thread, elem);
-    const struct thread *b_t = list_entry(b, struct thread, elem);
-    return a_t->wake_ticks < b_t->wake_ticks;
+    cycles = tsc_hz / 1000 * num / (denom / 1000);
+    while (rdtsc() - start < cycles)
+        barrier();
 }
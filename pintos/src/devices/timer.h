@@ -1,17 +1,68 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* Called from the timer interrupt when a timeout expires. */
+typedef void timeout_func(void *aux);
+
+/* A one-shot timeout that calls FUNC(AUX) from the timer
+   interrupt once DEADLINE, in timer ticks, is reached.  Arming
+   and cancelling a timeout both take constant time. */
+struct timeout
+{
+    int64_t deadline;      /* Tick at which to fire. */
+    timeout_func *func;    /* Function to call. */
+    void *aux;             /* Auxiliary data for FUNC. */
+    bool pending;          /* Armed and not yet fired? */
+    struct list_elem elem; /* Element in a timer wheel slot. */
+};
+
+/* A one-shot high-resolution timer that calls FUNC(AUX) from
+   the timer interrupt once DEADLINE, in nanoseconds as returned
+   by timer_now_ns(), is reached.  Arming takes time linear in
+   the number of pending hrtimers. */
+struct hrtimer
+{
+    uint64_t deadline;     /* Time at which to fire, in ns. */
+    timeout_func *func;    /* Function to call. */
+    void *aux;             /* Auxiliary data for FUNC. */
+    bool pending;          /* Armed and not yet fired? */
+    struct list_elem elem; /* Element in list of pending hrtimers. */
+};
+
+/* If false (default), the timer interrupts TIMER_FREQ times per
+   second.  If true, periodic interrupts stop while the CPU is idle.
+   Controlled by kernel command-line option "-tickless". */
+extern bool timer_tickless;
+
+/* TSC frequency in kHz, or 0 (default) to measure it at boot.
+   Controlled by kernel command-line option "-tsc-khz". */
+extern int timer_tsc_khz;
+
 void timer_init(void);
 void timer_calibrate(void);
 
 int64_t timer_ticks(void);
 int64_t timer_elapsed(int64_t);
+uint64_t timer_now_ns(void);
+uint64_t timer_tsc_to_ns(uint64_t cycles);
+
+/* Timeouts. */
+void timeout_init(struct timeout *, timeout_func *, void *aux);
+void timeout_arm(struct timeout *, int64_t deadline);
+bool timeout_cancel(struct timeout *);
+
+/* High-resolution timers. */
+void hrtimer_init(struct hrtimer *, timeout_func *, void *aux);
+void hrtimer_arm(struct hrtimer *, uint64_t deadline);
+bool hrtimer_cancel(struct hrtimer *);
 
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep(int64_t ticks);
@@ -24,6 +75,10 @@ void timer_mdelay(int64_t milliseconds);
 void timer_udelay(int64_t microseconds);
 void timer_ndelay(int64_t nanoseconds);
 
+/* Tickless idle. */
+void timer_idle_enter(void);
+void timer_idle_exit(void);
+
 void timer_print_stats(void);
 
 #endif /* devices/timer.h */
@@ -4,10 +4,26 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "threads/synch.h"
+#include "threads/workqueue.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per sector. */
 
+/* Protects FREE_MAP.  Held while the map is written out, so that
+   the image on disk is never torn by a concurrent allocation. */
+static struct lock free_map_lock;
+
+/* Writes the free map back to disk a little while after it
+   changes, so that a burst of allocations and releases costs a
+   single write, made by a worker thread instead of the thread
+   that allocated. */
+static struct delayed_work free_map_writer;
+#define FREE_MAP_WRITE_DELAY (TIMER_FREQ / 10)
+
+static work_func write_free_map;
+static void free_map_changed (void);
+
 /* Initializes the free map. */
 void
 free_map_init (void) 
@@ -17,24 +33,25 @@ free_map_init (void)
     PANIC ("bitmap creation failed--file system device is too large");
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  lock_init (&free_map_lock);
+  delayed_work_init (&free_map_writer, write_free_map, NULL);
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
    the first into *SECTORP.
    Returns true if successful, false if not enough consecutive
-   sectors were available or if the free_map file could not be
-   written. */
+   sectors were available. */
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
 {
-  block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-  if (sector != BITMAP_ERROR
-      && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
-    {
-      bitmap_set_multiple (free_map, sector, cnt, false); 
-      sector = BITMAP_ERROR;
-    }
+  block_sector_t sector;
+
+  lock_acquire (&free_map_lock);
+  sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+  if (sector != BITMAP_ERROR)
+    free_map_changed ();
+  lock_release (&free_map_lock);
+
   if (sector != BITMAP_ERROR)
     *sectorp = sector;
   return sector != BITMAP_ERROR;
@@ -44,9 +61,11 @@ free_map_allocate (size_t cnt, block_sector_t *sectorp)
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
+  lock_acquire (&free_map_lock);
   ASSERT (bitmap_all (free_map, sector, cnt));
   bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  free_map_changed ();
+  lock_release (&free_map_lock);
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -64,7 +83,9 @@ free_map_open (void)
 void
 free_map_close (void) 
 {
+  delayed_work_flush (&free_map_writer);
   file_close (free_map_file);
+  free_map_file = NULL;
 }
 
 /* Creates a new free map file on disk and writes the free map to
@@ -83,3 +104,26 @@ free_map_create (void)
   if (!bitmap_write (free_map, free_map_file))
     PANIC ("can't write free map");
 }
+
+/* Schedules the free map to be written to disk, unless a write
+   is already scheduled.  Until the free map file is open, there
+   is nothing to write it to. */
+static void
+free_map_changed (void)
+{
+  if (free_map_file != NULL)
+    workqueue_queue_delayed (&system_wq, &free_map_writer,
+                             FREE_MAP_WRITE_DELAY);
+}
+
+/* Writes the free map to disk, from a worker thread.  Changes
+   made while the write is in progress wait for it, then schedule
+   another write. */
+static void
+write_free_map (void *aux UNUSED)
+{
+  lock_acquire (&free_map_lock);
+  if (!bitmap_write (free_map, free_map_file))
+    PANIC ("can't write free map");
+  lock_release (&free_map_lock);
+}
@@ -5,6 +5,7 @@
 #include "devices/vga.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/klog.h"
 #include "threads/synch.h"
 
 static void vprintf_helper (char, void *);
@@ -69,11 +70,12 @@ console_init (void)
 
 /* Notifies the console that a kernel panic is underway,
    which warns it to avoid trying to take the console lock from
-   now on. */
+   now on, and prints what is left in the kernel log. */
 void
 console_panic (void) 
 {
   use_console_lock = false;
+  klog_panic ();
 }
 
 /* Prints console statistics. */
@@ -148,13 +150,18 @@ puts (const char *s)
   return 0;
 }
 
-/* Writes the N characters in BUFFER to the console. */
+/* Writes the N characters in BUFFER to the console, passing
+   them to the serial port all at once. */
 void
 putbuf (const char *buffer, size_t n) 
 {
+  size_t i;
+
   acquire_console ();
-  while (n-- > 0)
-    putchar_have_lock (*buffer++);
+  write_cnt += n;
+  serial_write (buffer, n);
+  for (i = 0; i < n; i++)
+    vga_putc (buffer[i]);
   release_console ();
 }
 
@@ -0,0 +1,218 @@
+/* Priority queue.
+
+   See heap.h for basic information.  The pairing heap is
+   described in Fredman, Sedgewick, Sleator, and Tarjan, "The
+   Pairing Heap: A New Form of Self-Adjusting Heap",
+   Algorithmica 1 (1986).
+
+   Each element's children form a doubly linked list through
+   `next' and `prev', starting at its `child'.  The first child's
+   `prev' points to the parent instead of a sibling. */
+
+#include "heap.h"
+#include "../debug.h"
+
+static bool is_less (const struct heap *, const struct heap_elem *,
+                     const struct heap_elem *);
+static struct heap_elem *link (struct heap *, struct heap_elem *,
+                               struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+static void insert (struct heap *, struct heap_elem *);
+
+/* Initializes H as an empty heap that compares elements using
+   LESS, given auxiliary data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux)
+{
+  ASSERT (h != NULL);
+  ASSERT (less != NULL);
+
+  h->root = NULL;
+  h->elem_cnt = 0;
+  h->next_seq = 0;
+  h->less = less;
+  h->aux = aux;
+}
+
+/* Inserts E into H. */
+void
+heap_push (struct heap *h, struct heap_elem *e)
+{
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+
+  e->seq = h->next_seq++;
+  insert (h, e);
+  h->elem_cnt++;
+}
+
+/* Returns the greatest element in H, or a null pointer if H is
+   empty.  If several elements are greatest, returns the one that
+   was inserted first. */
+struct heap_elem *
+heap_top (const struct heap *h)
+{
+  return h->root;
+}
+
+/* Removes and returns the greatest element in H, which must not
+   be empty. */
+struct heap_elem *
+heap_pop (struct heap *h)
+{
+  struct heap_elem *top = h->root;
+
+  ASSERT (top != NULL);
+
+  heap_remove (h, top);
+  return top;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e)
+{
+  struct heap_elem *children;
+
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+  ASSERT (h->elem_cnt > 0);
+
+  children = merge_pairs (h, e->child);
+  if (e == h->root)
+    h->root = children;
+  else
+    {
+      /* Cut E's subtree out of its parent's list of children. */
+      if (e->prev->child == e)
+        e->prev->child = e->next;
+      else
+        e->prev->next = e->next;
+      if (e->next != NULL)
+        e->next->prev = e->prev;
+      if (children != NULL)
+        h->root = link (h, h->root, children);
+    }
+  h->elem_cnt--;
+}
+
+/* Moves E, which must be in H, to its proper place after its
+   key has changed.  E keeps its place among elements that
+   compare equal to it. */
+void
+heap_update (struct heap *h, struct heap_elem *e)
+{
+  ASSERT (h != NULL);
+  ASSERT (e != NULL);
+
+  heap_remove (h, e);
+  insert (h, e);
+  h->elem_cnt++;
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (const struct heap *h)
+{
+  return h->elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+heap_empty (const struct heap *h)
+{
+  return h->elem_cnt == 0;
+}
+
+/* Returns true if A should come out of H after B: A is less
+   than B, or they compare equal and A was inserted later. */
+static bool
+is_less (const struct heap *h, const struct heap_elem *a,
+         const struct heap_elem *b)
+{
+  if (h->less (a, b, h->aux))
+    return true;
+  else if (h->less (b, a, h->aux))
+    return false;
+  else
+    return (int) (a->seq - b->seq) > 0;
+}
+
+/* Links the trees rooted at A and B, neither of which has a
+   parent or siblings, by making the lesser root the first child
+   of the other.  Returns the root of the combined tree. */
+static struct heap_elem *
+link (struct heap *h, struct heap_elem *a, struct heap_elem *b)
+{
+  if (is_less (h, a, b))
+    {
+      struct heap_elem *t = a;
+      a = b;
+      b = t;
+    }
+
+  b->prev = a;
+  b->next = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  a->child = b;
+  return a;
+}
+
+/* Combines the list of sibling trees starting at FIRST into a
+   single tree and returns its root, or a null pointer if FIRST
+   is null.  Links the trees in pairs from left to right, then
+   links the results from right to left. */
+static struct heap_elem *
+merge_pairs (struct heap *h, struct heap_elem *first)
+{
+  struct heap_elem *pairs = NULL;
+  struct heap_elem *root;
+
+  /* First pass.  Builds the list of linked pairs in reverse
+     order, through `next'. */
+  while (first != NULL)
+    {
+      struct heap_elem *a = first;
+      struct heap_elem *b = a->next;
+
+      if (b != NULL)
+        {
+          first = b->next;
+          b->next = b->prev = NULL;
+          a->next = a->prev = NULL;
+          a = link (h, a, b);
+        }
+      else
+        {
+          first = NULL;
+          a->prev = NULL;
+        }
+      a->next = pairs;
+      pairs = a;
+    }
+
+  /* Second pass. */
+  if (pairs == NULL)
+    return NULL;
+  root = pairs;
+  pairs = pairs->next;
+  root->next = NULL;
+  while (pairs != NULL)
+    {
+      struct heap_elem *next = pairs->next;
+      pairs->next = NULL;
+      root = link (h, root, pairs);
+      pairs = next;
+    }
+  return root;
+}
+
+/* Adds E to H as a new tree, without changing its sequence
+   number or H's element count. */
+static void
+insert (struct heap *h, struct heap_elem *e)
+{
+  e->child = e->next = e->prev = NULL;
+  h->root = h->root != NULL ? link (h, h->root, e) : e;
+}
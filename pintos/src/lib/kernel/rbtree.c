@@ -0,0 +1,339 @@
+/* Red-black tree.
+
+   See rbtree.h for basic information.  The balancing follows
+   chapter 13 of Cormen et al., "Introduction to Algorithms",
+   with null pointers in place of the sentinel leaf. */
+
+#include "rbtree.h"
+#include "../debug.h"
+
+static void rotate_left (struct rb_tree *, struct rb_elem *);
+static void rotate_right (struct rb_tree *, struct rb_elem *);
+static void replace_child (struct rb_tree *, struct rb_elem *old,
+                           struct rb_elem *new);
+static void insert_fixup (struct rb_tree *, struct rb_elem *);
+static void remove_fixup (struct rb_tree *, struct rb_elem *,
+                          struct rb_elem *parent);
+
+/* Initializes T as an empty tree that compares elements using
+   LESS, given auxiliary data AUX. */
+void
+rb_init (struct rb_tree *t, rb_less_func *less, void *aux)
+{
+  ASSERT (t != NULL);
+  ASSERT (less != NULL);
+
+  t->root = NULL;
+  t->min = NULL;
+  t->elem_cnt = 0;
+  t->less = less;
+  t->aux = aux;
+}
+
+/* Inserts E into T.  E goes after any elements that compare
+   equal to it. */
+void
+rb_insert (struct rb_tree *t, struct rb_elem *e)
+{
+  struct rb_elem *parent = NULL;
+  struct rb_elem **link = &t->root;
+  bool leftmost = true;
+
+  ASSERT (t != NULL);
+  ASSERT (e != NULL);
+
+  while (*link != NULL)
+    {
+      parent = *link;
+      if (t->less (e, parent, t->aux))
+        link = &parent->left;
+      else
+        {
+          link = &parent->right;
+          leftmost = false;
+        }
+    }
+
+  e->parent = parent;
+  e->left = e->right = NULL;
+  e->red = true;
+  *link = e;
+  if (leftmost)
+    t->min = e;
+  t->elem_cnt++;
+
+  insert_fixup (t, e);
+}
+
+/* Removes E, which must be in T, from T. */
+void
+rb_remove (struct rb_tree *t, struct rb_elem *e)
+{
+  struct rb_elem *child, *parent;
+  bool red;
+
+  ASSERT (t != NULL);
+  ASSERT (e != NULL);
+  ASSERT (t->elem_cnt > 0);
+
+  if (t->min == e)
+    t->min = rb_next (e);
+
+  if (e->left == NULL || e->right == NULL)
+    {
+      /* E has at most one child, which takes its place. */
+      child = e->left != NULL ? e->left : e->right;
+      parent = e->parent;
+      red = e->red;
+      if (child != NULL)
+        child->parent = parent;
+      replace_child (t, e, child);
+    }
+  else
+    {
+      /* E's successor S has no left child.  S takes E's place
+         and color, and S's right child takes S's place. */
+      struct rb_elem *s = e->right;
+
+      while (s->left != NULL)
+        s = s->left;
+      child = s->right;
+      red = s->red;
+
+      if (s->parent == e)
+        parent = s;
+      else
+        {
+          parent = s->parent;
+          parent->left = child;
+          if (child != NULL)
+            child->parent = parent;
+          s->right = e->right;
+          s->right->parent = s;
+        }
+      s->left = e->left;
+      s->left->parent = s;
+      s->parent = e->parent;
+      s->red = e->red;
+      replace_child (t, e, s);
+    }
+  t->elem_cnt--;
+
+  /* Removing a black element leaves one path short. */
+  if (!red)
+    remove_fixup (t, child, parent);
+}
+
+/* Returns the smallest element in T, or a null pointer if T is
+   empty.  Takes constant time. */
+struct rb_elem *
+rb_min (const struct rb_tree *t)
+{
+  return t->min;
+}
+
+/* Returns the element that follows E in its tree, or a null
+   pointer if E is the largest element. */
+struct rb_elem *
+rb_next (const struct rb_elem *e)
+{
+  if (e->right != NULL)
+    {
+      e = e->right;
+      while (e->left != NULL)
+        e = e->left;
+      return (struct rb_elem *) e;
+    }
+  while (e->parent != NULL && e == e->parent->right)
+    e = e->parent;
+  return e->parent;
+}
+
+/* Returns the number of elements in T. */
+size_t
+rb_size (const struct rb_tree *t)
+{
+  return t->elem_cnt;
+}
+
+/* Returns true if T contains no elements, false otherwise. */
+bool
+rb_empty (const struct rb_tree *t)
+{
+  return t->elem_cnt == 0;
+}
+
+/* Makes NEW take the place of OLD as a child of OLD's parent, or
+   as T's root.  Does not update NEW's parent pointer. */
+static void
+replace_child (struct rb_tree *t, struct rb_elem *old, struct rb_elem *new)
+{
+  if (old->parent == NULL)
+    t->root = new;
+  else if (old == old->parent->left)
+    old->parent->left = new;
+  else
+    old->parent->right = new;
+}
+
+/* Rotates the subtree rooted at E to the left, making E's right
+   child its new root. */
+static void
+rotate_left (struct rb_tree *t, struct rb_elem *e)
+{
+  struct rb_elem *r = e->right;
+
+  e->right = r->left;
+  if (r->left != NULL)
+    r->left->parent = e;
+  r->parent = e->parent;
+  replace_child (t, e, r);
+  r->left = e;
+  e->parent = r;
+}
+
+/* Rotates the subtree rooted at E to the right, making E's left
+   child its new root. */
+static void
+rotate_right (struct rb_tree *t, struct rb_elem *e)
+{
+  struct rb_elem *l = e->left;
+
+  e->left = l->right;
+  if (l->right != NULL)
+    l->right->parent = e;
+  l->parent = e->parent;
+  replace_child (t, e, l);
+  l->right = e;
+  e->parent = l;
+}
+
+/* Restores the red-black properties after red element E has
+   been inserted into T. */
+static void
+insert_fixup (struct rb_tree *t, struct rb_elem *e)
+{
+  while (e->parent != NULL && e->parent->red)
+    {
+      struct rb_elem *parent = e->parent;
+      struct rb_elem *grandparent = parent->parent;
+
+      if (parent == grandparent->left)
+        {
+          struct rb_elem *uncle = grandparent->right;
+          if (uncle != NULL && uncle->red)
+            {
+              parent->red = uncle->red = false;
+              grandparent->red = true;
+              e = grandparent;
+              continue;
+            }
+          if (e == parent->right)
+            {
+              rotate_left (t, parent);
+              e = parent;
+              parent = e->parent;
+            }
+          parent->red = false;
+          grandparent->red = true;
+          rotate_right (t, grandparent);
+        }
+      else
+        {
+          struct rb_elem *uncle = grandparent->left;
+          if (uncle != NULL && uncle->red)
+            {
+              parent->red = uncle->red = false;
+              grandparent->red = true;
+              e = grandparent;
+              continue;
+            }
+          if (e == parent->left)
+            {
+              rotate_right (t, parent);
+              e = parent;
+              parent = e->parent;
+            }
+          parent->red = false;
+          grandparent->red = true;
+          rotate_left (t, grandparent);
+        }
+    }
+  t->root->red = false;
+}
+
+/* Restores the red-black properties after a black element has
+   been removed from T.  E, which may be null, took the removed
+   element's place as a child of PARENT and is one black element
+   short on all of its paths. */
+static void
+remove_fixup (struct rb_tree *t, struct rb_elem *e, struct rb_elem *parent)
+{
+  while (e != t->root && (e == NULL || !e->red))
+    {
+      if (e == parent->left)
+        {
+          struct rb_elem *sibling = parent->right;
+          if (sibling->red)
+            {
+              sibling->red = false;
+              parent->red = true;
+              rotate_left (t, parent);
+              sibling = parent->right;
+            }
+          if ((sibling->left == NULL || !sibling->left->red)
+              && (sibling->right == NULL || !sibling->right->red))
+            {
+              sibling->red = true;
+              e = parent;
+              parent = e->parent;
+              continue;
+            }
+          if (sibling->right == NULL || !sibling->right->red)
+            {
+              sibling->left->red = false;
+              sibling->red = true;
+              rotate_right (t, sibling);
+              sibling = parent->right;
+            }
+          sibling->red = parent->red;
+          parent->red = false;
+          sibling->right->red = false;
+          rotate_left (t, parent);
+        }
+      else
+        {
+          struct rb_elem *sibling = parent->left;
+          if (sibling->red)
+            {
+              sibling->red = false;
+              parent->red = true;
+              rotate_right (t, parent);
+              sibling = parent->left;
+            }
+          if ((sibling->left == NULL || !sibling->left->red)
+              && (sibling->right == NULL || !sibling->right->red))
+            {
+              sibling->red = true;
+              e = parent;
+              parent = e->parent;
+              continue;
+            }
+          if (sibling->left == NULL || !sibling->left->red)
+            {
+              sibling->right->red = false;
+              sibling->red = true;
+              rotate_left (t, sibling);
+              sibling = parent->left;
+            }
+          sibling->red = parent->red;
+          parent->red = false;
+          sibling->left->red = false;
+          rotate_right (t, parent);
+        }
+      e = t->root;
+      break;
+    }
+  if (e != NULL)
+    e->red = false;
+}
@@ -28,7 +28,14 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Multithreaded processes. */
+    SYS_THREAD_CREATE,          /* Start another thread in this process. */
+    SYS_THREAD_EXIT,            /* Terminate this thread. */
+    SYS_THREAD_JOIN,            /* Wait for a thread to die. */
+    SYS_FUTEX_WAIT,             /* Sleep if a word has a given value. */
+    SYS_FUTEX_WAKE              /* Wake threads sleeping on a word. */
   };
 
 #endif /* lib/syscall-nr.h */
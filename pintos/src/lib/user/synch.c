@@ -0,0 +1,119 @@
+#include <synch.h>
+#include <limits.h>
+#include <syscall.h>
+
+/* Mutexes follow "mutex, take 3" from Ulrich Drepper, "Futexes
+   Are Tricky": a thread about to wait sets the state to 2, so an
+   unlock that finds 1 knows nobody waits and makes no system
+   call. */
+
+/* Atomically sets *P to NEW if it is OLD.  Returns the old value
+   of *P. */
+static inline int
+compare_exchange (int *p, int old, int new)
+{
+  int prev;
+
+  asm volatile ("lock cmpxchgl %2, %1"
+                : "=a" (prev), "+m" (*p)
+                : "r" (new), "0" (old)
+                : "memory");
+  return prev;
+}
+
+/* Atomically sets *P to NEW.  Returns the old value of *P. */
+static inline int
+exchange (int *p, int new)
+{
+  asm volatile ("xchgl %0, %1"
+                : "+r" (new), "+m" (*p)
+                :
+                : "memory");
+  return new;
+}
+
+/* Atomically adds N to *P.  Returns the old value of *P. */
+static inline int
+fetch_add (int *p, int n)
+{
+  asm volatile ("lock xaddl %0, %1"
+                : "+r" (n), "+m" (*p)
+                :
+                : "memory");
+  return n;
+}
+
+/* Initializes MUTEX as unlocked. */
+void
+mutex_init (struct mutex *mutex)
+{
+  mutex->state = 0;
+}
+
+/* Locks MUTEX, sleeping until it is unlocked if necessary.  The
+   mutex must not already be held by the current thread. */
+void
+mutex_lock (struct mutex *mutex)
+{
+  int c = compare_exchange (&mutex->state, 0, 1);
+
+  if (c == 0)
+    return;
+  if (c != 2)
+    c = exchange (&mutex->state, 2);
+  while (c != 0)
+    {
+      futex_wait (&mutex->state, 2);
+      c = exchange (&mutex->state, 2);
+    }
+}
+
+/* Unlocks MUTEX, which the current thread must hold, waking up
+   one waiter if there may be any. */
+void
+mutex_unlock (struct mutex *mutex)
+{
+  if (fetch_add (&mutex->state, -1) != 1)
+    {
+      exchange (&mutex->state, 0);
+      futex_wake (&mutex->state, 1);
+    }
+}
+
+/* Initializes COND. */
+void
+cond_init (struct condition *cond)
+{
+  cond->seq = 0;
+}
+
+/* Atomically unlocks MUTEX and waits for COND to be signaled,
+   then locks MUTEX again.  As with any condition variable, the
+   caller must recheck its condition afterward. */
+void
+cond_wait (struct condition *cond, struct mutex *mutex)
+{
+  int seq = *(volatile int *) &cond->seq;
+
+  /* A signal between the unlock and the wait changes SEQ, so
+     futex_wait() returns right away instead of missing it. */
+  mutex_unlock (mutex);
+  futex_wait (&cond->seq, seq);
+  mutex_lock (mutex);
+}
+
+/* Wakes up one thread waiting on COND, if any. */
+void
+cond_signal (struct condition *cond)
+{
+  fetch_add (&cond->seq, 1);
+  futex_wake (&cond->seq, 1);
+}
+
+/* Wakes up all threads waiting on COND. */
+void
+cond_broadcast (struct condition *cond)
+{
+  fetch_add (&cond->seq, 1);
+  futex_wake (&cond->seq, INT_MAX);
+}
@@ -0,0 +1,35 @@
+#ifndef __LIB_USER_SYNCH_H
+#define __LIB_USER_SYNCH_H
+
+/* A mutex for the threads of a process.  Locking a mutex that
+   is free and unlocking one that nobody waits for stay in user
+   space; only threads that have to wait, and the threads that
+   wake them up, make system calls. */
+struct mutex
+  {
+    int state;                  /* 0: unlocked, 1: locked,
+                                   2: locked, maybe with waiters. */
+  };
+
+/* Initializer for a static mutex. */
+#define MUTEX_INITIALIZER { 0 }
+
+void mutex_init (struct mutex *);
+void mutex_lock (struct mutex *);
+void mutex_unlock (struct mutex *);
+
+/* A condition variable. */
+struct condition
+  {
+    int seq;                    /* Changed by each signal. */
+  };
+
+/* Initializer for a static condition variable. */
+#define CONDITION_INITIALIZER { 0 }
+
+void cond_init (struct condition *);
+void cond_wait (struct condition *, struct mutex *);
+void cond_signal (struct condition *);
+void cond_broadcast (struct condition *);
+
+#endif /* lib/user/synch.h */
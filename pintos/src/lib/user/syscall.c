@@ -182,3 +182,43 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+/* Entry point of a thread started by uthread_create(): runs
+   FUNC(AUX), then ends the thread. */
+static void
+uthread_start (uthread_func *func, void *aux)
+{
+  func (aux);
+  uthread_exit ();
+}
+
+int
+uthread_create (uthread_func *func, void *aux)
+{
+  return syscall3 (SYS_THREAD_CREATE, uthread_start, func, aux);
+}
+
+void
+uthread_exit (void)
+{
+  syscall0 (SYS_THREAD_EXIT);
+  NOT_REACHED ();
+}
+
+int
+uthread_join (int tid)
+{
+  return syscall1 (SYS_THREAD_JOIN, tid);
+}
+
+int
+futex_wait (int *addr, int expected)
+{
+  return syscall2 (SYS_FUTEX_WAIT, addr, expected);
+}
+
+int
+futex_wake (int *addr, int n)
+{
+  return syscall2 (SYS_FUTEX_WAKE, addr, n);
+}
@@ -12,6 +12,9 @@ typedef int pid_t;
 typedef int mapid_t;
 #define MAP_FAILED ((mapid_t) -1)
 
+/* Function run by a thread started with uthread_create(). */
+typedef void uthread_func (void *aux);
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
@@ -45,4 +48,11 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Multithreaded processes. */
+int uthread_create (uthread_func *, void *aux);
+void uthread_exit (void) NO_RETURN;
+int uthread_join (int tid);
+int futex_wait (int *addr, int expected);
+int futex_wake (int *addr, int n);
+
 #endif /* lib/user/syscall.h */
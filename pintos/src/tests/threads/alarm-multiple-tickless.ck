@@ -0,0 +1,18 @@
+# -*- perl -*-
+use tests::tests;
+use tests::threads::alarm;
+
+# Same as alarm-multiple, but with the periodic timer stopped
+# while idle.  Besides the wakeups, check that ticks were really
+# skipped and caught up with.
+our ($test);
+my (@output) = read_text_file ("$test.output");
+my ($ticks) = map (/^Timer: (\d+) ticks$/, @output);
+my ($interrupts) = map (/^Timer: (\d+) interrupts in tickless mode$/, @output);
+my ($idle) = map (/^Thread: (\d+) idle ticks/, @output);
+fail "missing timer statistics\n"
+  if !defined $ticks || !defined $interrupts || !defined $idle;
+fail "$interrupts timer interrupts for $ticks ticks: none skipped\n"
+  if $interrupts >= $ticks;
+fail "no idle ticks counted\n" if $idle == 0;
+check_alarm (7);
@@ -0,0 +1,143 @@
+/* Creates 1,000 threads, each of which sleeps a different, fixed
+   duration, 3 times.  Records the wake-up order and verifies
+   that it is valid and that no thread woke up early.  Exercises
+   timer_sleep() with many more sleepers than alarm-multiple. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 1000
+#define ITERATIONS 3
+
+/* Information about the test. */
+struct sleep_test
+  {
+    int64_t start;              /* Current time at start of test. */
+    struct semaphore go;        /* Released once per sleeper to start. */
+    struct semaphore done;      /* Upped by each sleeper when done. */
+
+    /* Output. */
+    struct lock output_lock;    /* Lock protecting output buffer. */
+    int *output_pos;            /* Current position in output buffer. */
+    int early_cnt;              /* Number of early wakeups. */
+  };
+
+/* Information about an individual thread in the test. */
+struct sleep_thread
+  {
+    struct sleep_test *test;     /* Info shared between all threads. */
+    int id;                     /* Sleeper ID. */
+    int duration;               /* Number of ticks to sleep. */
+    int iterations;             /* Iterations counted so far. */
+  };
+
+static void sleeper (void *);
+
+void
+test_alarm_scale (void)
+{
+  struct sleep_test test;
+  struct sleep_thread *threads;
+  int *output, *op;
+  int product;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  msg ("Creating %d threads to sleep %d times each.", THREAD_CNT, ITERATIONS);
+
+  /* Allocate memory. */
+  threads = malloc (sizeof *threads * THREAD_CNT);
+  output = malloc (sizeof *output * ITERATIONS * THREAD_CNT);
+  if (threads == NULL || output == NULL)
+    PANIC ("couldn't allocate memory for test");
+
+  /* Initialize test. */
+  sema_init (&test.go, 0);
+  sema_init (&test.done, 0);
+  lock_init (&test.output_lock);
+  test.output_pos = output;
+  test.early_cnt = 0;
+
+  /* Start threads. */
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      struct sleep_thread *t = threads + i;
+
+      t->test = &test;
+      t->id = i;
+      t->duration = 10 + i % 50;
+      t->iterations = 0;
+      if (thread_create ("sleeper", PRI_DEFAULT, sleeper, t) == TID_ERROR)
+        fail ("couldn't create thread %d", i);
+    }
+
+  /* Release all the sleepers at once. */
+  test.start = timer_ticks () + 100;
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_up (&test.go);
+
+  /* Wait for all the threads to finish. */
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&test.done);
+
+  msg ("All threads woke up %d times.", ITERATIONS);
+
+  /* Verify completion order. */
+  product = 0;
+  for (op = output; op < test.output_pos; op++)
+    {
+      struct sleep_thread *t;
+      int new_prod;
+
+      ASSERT (*op >= 0 && *op < THREAD_CNT);
+      t = threads + *op;
+
+      new_prod = ++t->iterations * t->duration;
+      if (new_prod >= product)
+        product = new_prod;
+      else
+        fail ("thread %d woke up out of order (%d > %d)!",
+              t->id, product, new_prod);
+    }
+  if (test.early_cnt != 0)
+    fail ("%d wakeups happened too early", test.early_cnt);
+  msg ("Wakeups were in order.");
+
+  /* Verify that we had the proper number of wakeups. */
+  for (i = 0; i < THREAD_CNT; i++)
+    if (threads[i].iterations != ITERATIONS)
+      fail ("thread %d woke up %d times instead of %d",
+            i, threads[i].iterations, ITERATIONS);
+
+  free (output);
+  free (threads);
+}
+
+/* Sleeper thread. */
+static void
+sleeper (void *t_)
+{
+  struct sleep_thread *t = t_;
+  struct sleep_test *test = t->test;
+  int i;
+
+  sema_down (&test->go);
+  for (i = 1; i <= ITERATIONS; i++)
+    {
+      int64_t sleep_until = test->start + i * t->duration;
+      timer_sleep (sleep_until - timer_ticks ());
+      lock_acquire (&test->output_lock);
+      if (timer_ticks () < sleep_until)
+        test->early_cnt++;
+      *test->output_pos++ = t->id;
+      lock_release (&test->output_lock);
+    }
+  sema_up (&test->done);
+}
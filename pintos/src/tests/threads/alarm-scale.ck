@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-scale) begin
+(alarm-scale) Creating 1000 threads to sleep 3 times each.
+(alarm-scale) All threads woke up 3 times.
+(alarm-scale) Wakeups were in order.
+(alarm-scale) end
+EOF
+pass;
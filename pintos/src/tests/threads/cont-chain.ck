@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(cont-chain) begin
+(cont-chain) step 0 ran in thread context.
+(cont-chain) step 1 ran in interrupt context.
+(cont-chain) step 2 ran in interrupt context.
+(cont-chain) step 3 ran in interrupt context.
+(cont-chain) step 4 ran in interrupt context.
+(cont-chain) Last step slept on a worker thread.
+(cont-chain) end
+EOF
+pass;
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(cont-sema) begin
+(cont-sema) 1000 continuations waiting on a semaphore.
+(cont-sema) All of them ran, in the order they waited.
+(cont-sema) A continuation ran at once when the semaphore was up.
+(cont-sema) end
+EOF
+pass;
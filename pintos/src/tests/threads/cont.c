@@ -0,0 +1,145 @@
+/* Tests continuations.
+
+   cont-sema checks that many continuations can wait on a
+   semaphore at once, without a thread each, and that they are
+   handed the semaphore's ups in the order they started
+   waiting.
+
+   cont-chain runs a small state machine whose steps are
+   continuations scheduled by timeouts, so that each step after
+   the first runs at the end of the timer interrupt.  Its last
+   step runs on a worker thread, where it may sleep. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cont.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+/* Number of continuations waiting on the semaphore. */
+#define CONT_CNT 1000
+
+static struct cont conts[CONT_CNT];
+static int order[CONT_CNT];
+static int ran_cnt;
+
+static cont_func record_cont;
+
+void
+test_cont_sema (void)
+{
+  struct semaphore sema;
+  int i;
+
+  sema_init (&sema, 0);
+  for (i = 0; i < CONT_CNT; i++)
+    {
+      cont_init (&conts[i], record_cont, (void *) i);
+      sema_down_async (&sema, &conts[i]);
+    }
+  msg ("%d continuations waiting on a semaphore.", CONT_CNT);
+  if (ran_cnt != 0)
+    fail ("%d continuations ran before the semaphore was upped", ran_cnt);
+
+  for (i = 0; i < CONT_CNT; i++)
+    sema_up (&sema);
+  if (ran_cnt != CONT_CNT)
+    fail ("only %d continuations ran", ran_cnt);
+  for (i = 0; i < CONT_CNT; i++)
+    if (order[i] != i)
+      fail ("continuation %d ran in place of %d", order[i], i);
+  msg ("All of them ran, in the order they waited.");
+  if (sema.value != 0)
+    fail ("semaphore value is %u", sema.value);
+
+  sema_up (&sema);
+  cont_init (&conts[0], record_cont, (void *) 0);
+  sema_down_async (&sema, &conts[0]);
+  if (ran_cnt != CONT_CNT + 1 || sema.value != 0)
+    fail ("continuation did not take the semaphore's value");
+  msg ("A continuation ran at once when the semaphore was up.");
+}
+
+/* Records that the continuation numbered CONT_ ran. */
+static void
+record_cont (void *cont_)
+{
+  order[ran_cnt++ % CONT_CNT] = (int) cont_;
+}
+
+/* Number of steps in the state machine, not counting the one
+   on the worker thread. */
+#define STEP_CNT 5
+
+struct chain
+  {
+    struct cont step;           /* Next step. */
+    struct timeout timeout;     /* Schedules the next step. */
+    struct cont last;           /* Last step, on a worker. */
+    int step_cnt;               /* Steps run so far. */
+    bool in_intr[STEP_CNT];     /* Did each step run in an interrupt? */
+    struct semaphore done;      /* Upped by the last step. */
+  };
+
+static cont_func chain_step;
+static cont_func chain_last;
+static timeout_func chain_timeout;
+
+void
+test_cont_chain (void)
+{
+  struct chain chain;
+  int i;
+
+  chain.step_cnt = 0;
+  sema_init (&chain.done, 0);
+  cont_init (&chain.step, chain_step, &chain);
+  timeout_init (&chain.timeout, chain_timeout, &chain);
+  cont_init (&chain.last, chain_last, &chain);
+  cont_set_workqueue (&chain.last, &system_wq);
+
+  cont_schedule (&chain.step);
+  sema_down (&chain.done);
+
+  for (i = 0; i < STEP_CNT; i++)
+    msg ("step %d ran in %s context.", i,
+         chain.in_intr[i] ? "interrupt" : "thread");
+  msg ("Last step slept on a worker thread.");
+}
+
+/* Runs one step of CHAIN_, and arranges for the next. */
+static void
+chain_step (void *chain_)
+{
+  struct chain *chain = chain_;
+
+  chain->in_intr[chain->step_cnt++] = intr_context ();
+  if (chain->step_cnt < STEP_CNT)
+    timeout_arm (&chain->timeout, timer_ticks () + 1);
+  else
+    cont_schedule (&chain->last);
+}
+
+/* Schedules the next step of CHAIN_ from the timer
+   interrupt. */
+static void
+chain_timeout (void *chain_)
+{
+  struct chain *chain = chain_;
+
+  cont_schedule (&chain->step);
+}
+
+/* Last step of CHAIN_, which sleeps before finishing. */
+static void
+chain_last (void *chain_)
+{
+  struct chain *chain = chain_;
+
+  timer_sleep (1);
+  sema_up (&chain->done);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-budget) begin
+(edf-budget) Starting a periodic thread with a budget of 2 ticks every 5.
+(edf-budget) Periodic thread kept to its budget.
+(edf-budget) Every period missed its deadline and ran out of budget.
+(edf-budget) end
+EOF
+pass;
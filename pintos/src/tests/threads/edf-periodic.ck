@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-periodic) begin
+(edf-periodic) Running 20 jobs every 5 ticks while busy at priority 63.
+(edf-periodic) Every job ran at the start of its period.
+(edf-periodic) 19 jobs completed before the last, 0 deadlines missed.
+(edf-periodic) end
+EOF
+pass;
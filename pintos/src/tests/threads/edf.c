@@ -0,0 +1,138 @@
+/* Tests periodic threads scheduled earliest deadline first.
+
+   edf-periodic checks that a periodic thread runs its job at the
+   start of every period, even while a thread of the highest
+   priority keeps the CPU busy, and misses no deadlines.
+
+   edf-budget checks that a periodic thread whose job never ends
+   runs for no more than its budget in each period, leaving the
+   rest of the CPU to other threads, and that each period counts
+   as a missed deadline. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of jobs to run in edf-periodic. */
+#define JOB_CNT 20
+
+/* Period of the periodic thread, in ticks. */
+#define PERIOD 5
+
+struct edf_test
+  {
+    int jobs;                   /* Jobs run so far. */
+    int64_t starts[JOB_CNT];    /* Tick at which each job ran. */
+    volatile bool stop;         /* Tells the periodic thread to exit. */
+    struct periodic_stats stats; /* Periodic thread's statistics. */
+    struct semaphore done;      /* Upped when periodic thread exits. */
+  };
+
+static thread_func periodic_job;
+
+void
+test_edf_periodic (void)
+{
+  struct edf_test test;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  test.jobs = 0;
+  sema_init (&test.done, 0);
+  thread_set_priority (PRI_MAX);
+
+  msg ("Running %d jobs every %d ticks while busy at priority %d.",
+       JOB_CNT, PERIOD, PRI_MAX);
+  thread_create_periodic ("periodic", PERIOD, 1, periodic_job, &test);
+  while (!sema_try_down (&test.done))
+    continue;
+
+  for (i = 1; i < JOB_CNT; i++)
+    if (test.starts[i] - test.starts[i - 1] != PERIOD)
+      fail ("job %d ran %"PRId64" ticks after job %d", i,
+            test.starts[i] - test.starts[i - 1], i - 1);
+  msg ("Every job ran at the start of its period.");
+  if (test.stats.misses != 0)
+    fail ("%lld deadlines missed", test.stats.misses);
+  msg ("%lld jobs completed before the last, %lld deadlines missed.",
+       test.stats.jobs, test.stats.misses);
+}
+
+/* Records when it ran.  The last job exits the thread. */
+static void
+periodic_job (void *test_)
+{
+  struct edf_test *test = test_;
+
+  test->starts[test->jobs++] = timer_ticks ();
+  if (test->jobs == JOB_CNT)
+    {
+      thread_get_periodic_stats (&test->stats);
+      sema_up (&test->done);
+      thread_exit ();
+    }
+}
+
+static thread_func endless_job;
+
+void
+test_edf_budget (void)
+{
+  struct edf_test test;
+  int64_t start_time, last;
+  int seen = 0;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  test.stop = false;
+  sema_init (&test.done, 0);
+
+  msg ("Starting a periodic thread with a budget of 2 ticks every %d.",
+       PERIOD);
+  thread_create_periodic ("periodic", PERIOD, 2, endless_job, &test);
+
+  /* Count the ticks during which we get to run. */
+  start_time = last = timer_ticks ();
+  while (timer_elapsed (start_time) < 20 * PERIOD)
+    {
+      int64_t now = timer_ticks ();
+      if (now != last)
+        {
+          seen++;
+          last = now;
+        }
+    }
+  test.stop = true;
+  sema_down (&test.done);
+
+  if (seen < 10 * PERIOD)
+    fail ("main thread ran during only %d of %d ticks", seen, 20 * PERIOD);
+  if (seen > 18 * PERIOD)
+    fail ("periodic thread ran during only %d of %d ticks",
+          20 * PERIOD - seen, 20 * PERIOD);
+  msg ("Periodic thread kept to its budget.");
+  if (test.stats.misses < 15 || test.stats.throttles < 15)
+    fail ("only %lld deadlines missed and %lld throttles",
+          test.stats.misses, test.stats.throttles);
+  msg ("Every period missed its deadline and ran out of budget.");
+}
+
+/* Spins until told to stop, then exits the thread. */
+static void
+endless_job (void *test_)
+{
+  struct edf_test *test = test_;
+
+  while (!test->stop)
+    continue;
+  thread_get_periodic_stats (&test->stats);
+  sema_up (&test->done);
+  thread_exit ();
+}
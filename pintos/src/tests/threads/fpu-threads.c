@@ -0,0 +1,73 @@
+/* Checks that threads' FPU and SSE state survives context
+   switches.
+
+   Two threads each keep a counter in the x87 register stack and
+   another in an SSE register, and add 1 to both before every
+   yield.  The kernel is compiled with -msoft-float, so nothing
+   else touches those registers; if the other thread's state
+   leaked into them, the counters would come out wrong. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Number of times each thread counts and yields. */
+#define ITER_CNT 1000
+
+struct fpu_thread
+  {
+    int start;                  /* Initial value of counters. */
+    int x87, sse;               /* Final values of counters. */
+  };
+
+static struct semaphore done;
+static thread_func fpu_thread;
+
+void
+test_fpu_threads (void)
+{
+  struct fpu_thread threads[2] = {{1000, 0, 0}, {5000, 0, 0}};
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  for (i = 0; i < 2; i++)
+    thread_create ("fpu", PRI_DEFAULT, fpu_thread, &threads[i]);
+  for (i = 0; i < 2; i++)
+    sema_down (&done);
+
+  for (i = 0; i < 2; i++)
+    {
+      if (threads[i].x87 != threads[i].start + ITER_CNT)
+        fail ("thread %d: x87 counter is %d", i, threads[i].x87);
+      if (threads[i].sse != threads[i].start + ITER_CNT)
+        fail ("thread %d: SSE counter is %d", i, threads[i].sse);
+      msg ("thread %d counted from %d to %d.", i, threads[i].start,
+           threads[i].start + ITER_CNT);
+    }
+}
+
+static void
+fpu_thread (void *t_)
+{
+  struct fpu_thread *t = t_;
+  int i;
+
+  asm volatile ("fildl %0" : : "m" (t->start));
+  asm volatile ("cvtsi2ss %0, %%xmm0" : : "m" (t->start));
+  for (i = 0; i < ITER_CNT; i++)
+    {
+      static const float one = 1.0;
+
+      asm volatile ("fld1; faddp");
+      asm volatile ("addss %0, %%xmm0" : : "m" (one));
+      thread_yield ();
+    }
+  asm volatile ("fistpl %0" : "=m" (t->x87));
+  asm volatile ("cvttss2si %%xmm0, %0" : "=r" (t->sse));
+  sema_up (&done);
+}
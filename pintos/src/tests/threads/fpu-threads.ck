@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fpu-threads) begin
+(fpu-threads) thread 0 counted from 1000 to 2000.
+(fpu-threads) thread 1 counted from 5000 to 6000.
+(fpu-threads) end
+EOF
+pass;
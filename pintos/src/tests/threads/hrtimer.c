@@ -0,0 +1,81 @@
+/* Arms three high-resolution timers a fraction of a tick apart,
+   out of order, and checks that they fire in order of deadline
+   and none before its deadline.  Then sleeps for a few
+   microseconds at a time, and checks that each sleep lasts at
+   least as long as requested. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "devices/timer.h"
+
+#define TIMER_CNT 3
+#define SLEEP_CNT 10
+
+/* An hrtimer and when it fired. */
+struct hr_test
+{
+  struct hrtimer timer;
+  int id;
+  uint64_t fired;
+};
+
+static int fire_order[TIMER_CNT];
+static int fire_cnt;
+static struct semaphore done;
+
+static timeout_func record_fire;
+
+void
+test_hrtimer (void)
+{
+  static const int delays_us[TIMER_CNT] = {300, 100, 200};
+  struct hr_test tests[TIMER_CNT];
+  uint64_t start, prev;
+  int i;
+
+  sema_init (&done, 0);
+  start = timer_now_ns ();
+  for (i = 0; i < TIMER_CNT; i++)
+    {
+      tests[i].id = i;
+      hrtimer_init (&tests[i].timer, record_fire, &tests[i]);
+      hrtimer_arm (&tests[i].timer, start + delays_us[i] * 1000);
+    }
+  sema_down (&done);
+
+  for (i = 0; i < TIMER_CNT; i++)
+    msg ("Timer %d fired.", fire_order[i]);
+  for (i = 0; i < TIMER_CNT; i++)
+    if (tests[i].fired < tests[i].timer.deadline)
+      fail ("timer %d fired %llu ns early", i,
+            (unsigned long long) (tests[i].timer.deadline - tests[i].fired));
+
+  prev = timer_now_ns ();
+  for (i = 0; i < SLEEP_CNT; i++)
+    {
+      uint64_t now;
+
+      timer_usleep (50);
+      now = timer_now_ns ();
+      if (now - prev < 50 * 1000)
+        fail ("50 us sleep lasted only %llu ns",
+              (unsigned long long) (now - prev));
+      prev = now;
+    }
+  msg ("Each 50 us sleep lasted at least 50 us.");
+}
+
+/* Records that hrtimer T_ fired, and when. */
+static void
+record_fire (void *t_)
+{
+  struct hr_test *t = t_;
+
+  t->fired = timer_now_ns ();
+  fire_order[fire_cnt++] = t->id;
+  if (fire_cnt == TIMER_CNT)
+    sema_up (&done);
+}
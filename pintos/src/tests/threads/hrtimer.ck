@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(hrtimer) begin
+(hrtimer) Timer 1 fired.
+(hrtimer) Timer 2 fired.
+(hrtimer) Timer 0 fired.
+(hrtimer) Each 50 us sleep lasted at least 50 us.
+(hrtimer) end
+EOF
+pass;
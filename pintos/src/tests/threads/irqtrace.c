@@ -0,0 +1,26 @@
+/* Turns interrupts off for a long time, so that the
+   interrupts-off tracer, enabled with -irqtrace, has a section
+   of known length to report at shutdown.  While interrupts are
+   off, the timer cannot tick. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "devices/timer.h"
+
+void
+test_irqtrace (void)
+{
+  enum intr_level old_level;
+  int64_t start_time;
+
+  msg ("Spinning for 50 ms with interrupts off.");
+  start_time = timer_ticks ();
+  old_level = intr_disable ();
+  timer_mdelay (50);
+  if (timer_ticks () != start_time)
+    fail ("timer ticked with interrupts off");
+  intr_set_level (old_level);
+  msg ("Interrupts are back on.");
+}
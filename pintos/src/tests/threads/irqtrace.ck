@@ -0,0 +1,29 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+fail "Section count missing from output.\n"
+  if !grep (/^Interrupts off: [1-9]\d* sections, \d+ cycles on average$/,
+            @output);
+fail "Histogram missing from output.\n"
+  if !grep (/^Interrupts off:   (<|>=) +\d+ cycles: [1-9]\d*$/, @output);
+
+# The 50 ms section must be the longest, and at least a million
+# cycles long on any CPU that can run Pintos.
+my ($longest) = grep (/^Interrupts off:   +\d+ cycles, off at/, @output);
+fail "Longest sections missing from output.\n" if !defined $longest;
+my ($cycles) = $longest =~ /(\d+) cycles/;
+fail "Longest section is only $cycles cycles.\n" if $cycles < 1000000;
+
+compare_output ("run", \@output, [<<'EOF']);
+(irqtrace) begin
+(irqtrace) Spinning for 50 ms with interrupts off.
+(irqtrace) Interrupts are back on.
+(irqtrace) end
+EOF
+pass;
@@ -0,0 +1,92 @@
+/* Writes records to the kernel log at debug level, which the
+   console does not print by default, from a thread and from an
+   interrupt handler, then reads them back.  Then writes many
+   more records than the log holds and checks that the oldest
+   were overwritten and the newest kept, in order. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/klog.h"
+#include "devices/timer.h"
+
+#define OVERFLOW_CNT 2000
+
+static timeout_func log_from_interrupt;
+static bool find_record (const char *, struct klog_record *);
+
+void
+test_klog (void)
+{
+  struct klog_record r;
+  struct timeout timeout;
+  uint32_t seq;
+  int first, next, i;
+
+  klog (KLOG_DEBUG, "klog test from thread");
+  if (!find_record ("klog test from thread", &r))
+    fail ("record written by thread not found");
+  if (r.level != KLOG_DEBUG)
+    fail ("record has level %d, expected %d", r.level, KLOG_DEBUG);
+  msg ("Read back record written by thread.");
+
+  timeout_init (&timeout, log_from_interrupt, NULL);
+  timeout_arm (&timeout, timer_ticks () + 2);
+  timer_sleep (5);
+  if (!find_record ("klog test from interrupt", &r))
+    fail ("record written by interrupt handler not found");
+  msg ("Read back record written by interrupt handler.");
+
+  for (i = 0; i < OVERFLOW_CNT; i++)
+    klog (KLOG_DEBUG, "klog overflow %d", i);
+
+  /* The oldest records must be gone, and the rest kept in order
+     up to the last one written. */
+  first = next = -1;
+  seq = 0;
+  while (klog_read (&seq, &r))
+    if (!memcmp (r.msg, "klog overflow ", 14))
+      {
+        int n = atoi (r.msg + 14);
+
+        if (first == -1)
+          first = n;
+        else if (n != next)
+          fail ("record %d follows record %d", n, next - 1);
+        next = n + 1;
+      }
+  if (first <= 0)
+    fail ("oldest record %d not overwritten", first);
+  if (next != OVERFLOW_CNT)
+    fail ("newest record is %d, expected %d", next - 1, OVERFLOW_CNT - 1);
+  msg ("Oldest records overwritten, newest kept in order.");
+}
+
+/* Writes a record from the timer interrupt. */
+static void
+log_from_interrupt (void *aux UNUSED)
+{
+  ASSERT (intr_context ());
+  klog (KLOG_DEBUG, "klog test from interrupt");
+}
+
+/* Searches the log for the newest record with message MSG and
+   copies it into *R.  Returns true if one was found. */
+static bool
+find_record (const char *msg, struct klog_record *r)
+{
+  struct klog_record cur;
+  uint32_t seq = 0;
+  bool found = false;
+
+  while (klog_read (&seq, &cur))
+    if (!strcmp (cur.msg, msg))
+      {
+        *r = cur;
+        found = true;
+      }
+  return found;
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(klog) begin
+(klog) Read back record written by thread.
+(klog) Read back record written by interrupt handler.
+(klog) Oldest records overwritten, newest kept in order.
+(klog) end
+EOF
+pass;
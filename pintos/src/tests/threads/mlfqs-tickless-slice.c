@@ -0,0 +1,101 @@
+/* Checks that a time slice ends even when its last tick passes
+   while the CPU is idle in tickless mode.
+
+   The main thread runs through a tick, then sleeps on a
+   high-resolution timer that wakes it partway through a tick a
+   few ticks later, so that the idle period can end between tick
+   boundaries.  It then lets BURST_CNT other threads run through
+   one tick each.  If the tick boundaries skipped while idle did
+   not end the time slice, the scheduler would count more threads
+   as having run in one slice than a slice has ticks.  Repeats
+   with the idle period ending at each position within a slice. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Ticks per time slice, as in threads/thread.c. */
+#define SLICE_TICKS 4
+
+#define BURST_CNT SLICE_TICKS
+#define ITER_CNT (4 * SLICE_TICKS)
+#define NS_PER_TICK (1000000000 / TIMER_FREQ)
+
+static struct semaphore go;
+static struct semaphore done;
+static struct semaphore wake;
+
+static thread_func burst_thread;
+static timeout_func wake_main;
+static void spin_one_tick (void);
+
+void
+test_mlfqs_tickless_slice (void)
+{
+  struct hrtimer timer;
+  int i, j;
+
+  ASSERT (thread_mlfqs);
+
+  sema_init (&go, 0);
+  sema_init (&done, 0);
+  sema_init (&wake, 0);
+  hrtimer_init (&timer, wake_main, NULL);
+
+  for (i = 0; i < BURST_CNT; i++)
+    {
+      char name[16];
+
+      snprintf (name, sizeof name, "burst %d", i);
+      thread_create (name, PRI_DEFAULT, burst_thread, NULL);
+    }
+
+  for (i = 0; i < ITER_CNT; i++)
+    {
+      spin_one_tick ();
+
+      hrtimer_arm (&timer, timer_now_ns ()
+                           + (2 + i % SLICE_TICKS) * NS_PER_TICK
+                           + NS_PER_TICK / 2);
+      sema_down (&wake);
+
+      for (j = 0; j < BURST_CNT; j++)
+        sema_up (&go);
+      for (j = 0; j < BURST_CNT; j++)
+        sema_down (&done);
+    }
+
+  msg ("PASS");
+}
+
+/* Runs through one tick each time the main thread says so. */
+static void
+burst_thread (void *aux UNUSED)
+{
+  for (;;)
+    {
+      sema_down (&go);
+      spin_one_tick ();
+      sema_up (&done);
+    }
+}
+
+/* Wakes up the main thread. */
+static void
+wake_main (void *aux UNUSED)
+{
+  sema_up (&wake);
+}
+
+/* Busy-waits until the next timer tick. */
+static void
+spin_one_tick (void)
+{
+  int64_t start = timer_ticks ();
+
+  while (timer_ticks () == start)
+    continue;
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(mlfqs-tickless-slice) begin
+(mlfqs-tickless-slice) PASS
+(mlfqs-tickless-slice) end
+EOF
+pass;
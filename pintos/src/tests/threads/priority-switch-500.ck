@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "Context switch timing missing from output.\n"
+  if !grep (/\d+ context switches with 500 ready threads took \d+ ticks\./,
+            @output);
+fail "Not all filler threads ran.\n"
+  if !grep (/All 500 filler threads ran\./, @output);
+pass;
@@ -0,0 +1,123 @@
+/* Measures the cost of a context switch while many threads sit
+   in the run queue.
+
+   The main thread fills the run queue with THREAD_CNT
+   low-priority threads spread over many priority levels, then
+   lets two higher-priority threads yield to each other
+   YIELD_CNT times each.  Every yield is a full trip through the
+   scheduler, so the number of switches completed per timer tick
+   shows how scheduling cost scales with the number of ready
+   threads.  With a constant-time run queue the rate should be
+   about the same for 10, 100, and 500 ready threads. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static void test_priority_switch (int thread_cnt);
+
+void
+test_priority_switch_10 (void)
+{
+  test_priority_switch (10);
+}
+
+void
+test_priority_switch_100 (void)
+{
+  test_priority_switch (100);
+}
+
+void
+test_priority_switch_500 (void)
+{
+  test_priority_switch (500);
+}
+
+/* Number of times each ping-pong thread yields. */
+#define YIELD_CNT 10000
+
+struct switch_test
+  {
+    struct semaphore start;     /* Released once to start each pinger. */
+    struct semaphore done;      /* Upped by each thread when done. */
+  };
+
+static thread_func filler_thread;
+static thread_func pinger_thread;
+
+static void
+test_priority_switch (int thread_cnt)
+{
+  struct switch_test test;
+  int64_t start_time, elapsed;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Stay above the pingers until they are all set up. */
+  thread_set_priority (PRI_DEFAULT + 2);
+  sema_init (&test.start, 0);
+  sema_init (&test.done, 0);
+
+  msg ("Filling run queue with %d threads.", thread_cnt);
+  for (i = 0; i < thread_cnt; i++)
+    {
+      int priority = PRI_MIN + 1 + i % (PRI_DEFAULT - PRI_MIN - 1);
+
+      if (thread_create ("filler", priority, filler_thread, &test)
+          == TID_ERROR)
+        fail ("could not create thread %d", i);
+    }
+
+  for (i = 0; i < 2; i++)
+    {
+      thread_create ("pinger", PRI_DEFAULT + 1, pinger_thread, &test);
+      sema_up (&test.start);
+    }
+
+  /* Let the pingers run.  We get the CPU back only once both of
+     them are done, because the fillers have lower priority. */
+  start_time = timer_ticks ();
+  thread_set_priority (PRI_DEFAULT);
+  sema_down (&test.done);
+  sema_down (&test.done);
+  elapsed = timer_elapsed (start_time);
+
+  msg ("%d context switches with %d ready threads took %"PRId64" ticks.",
+       2 * YIELD_CNT, thread_cnt, elapsed);
+  msg ("%"PRId64" switches per tick.",
+       2 * YIELD_CNT / (elapsed > 0 ? elapsed : 1));
+
+  /* Let the fillers run to completion. */
+  for (i = 0; i < thread_cnt; i++)
+    sema_down (&test.done);
+  msg ("All %d filler threads ran.", thread_cnt);
+}
+
+/* Sits in the run queue until the measurement is over. */
+static void
+filler_thread (void *test_)
+{
+  struct switch_test *test = test_;
+
+  sema_up (&test->done);
+}
+
+/* Yields to the other pinger YIELD_CNT times. */
+static void
+pinger_thread (void *test_)
+{
+  struct switch_test *test = test_;
+  int i;
+
+  sema_down (&test->start);
+  for (i = 0; i < YIELD_CNT; i++)
+    thread_yield ();
+  sema_up (&test->done);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-donate) begin
+(rwlock-donate) reader1: got the lock
+(rwlock-donate) reader2: got the lock
+(rwlock-donate) writer: acquiring for writing
+(rwlock-donate) reader1 should have priority 40.  Actual priority: 40.
+(rwlock-donate) reader1 should have priority 32.  Actual priority: 32.
+(rwlock-donate) reader2 should have priority 40.  Actual priority: 40.
+(rwlock-donate) writer: got the lock
+(rwlock-donate) reader2 should have priority 33.  Actual priority: 33.
+(rwlock-donate) main: done
+(rwlock-donate) end
+EOF
+pass;
@@ -0,0 +1,121 @@
+/* Measures read-side throughput of a reader-writer lock.
+
+   READER_CNT threads each enter a read-side critical section
+   READ_CNT times, and sleep for a tick inside it, as a reader
+   might while waiting for a disk.  This is done once with the
+   threads sharing a reader-writer lock for reading, and once
+   with them sharing an ordinary lock.  Readers of the
+   reader-writer lock should overlap, so that their reads
+   complete several times faster than under the lock, which lets
+   only one of them in at a time. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of reader threads. */
+#define READER_CNT 8
+
+/* Number of reads by each reader. */
+#define READ_CNT 10
+
+struct throughput_test
+  {
+    bool shared;                /* Use rwlock, or else lock? */
+    struct rwlock rwlock;
+    struct lock lock;
+    int inside;                 /* Readers in critical section. */
+    int max_inside;             /* Most readers in it at once. */
+    struct semaphore done;      /* Upped by each reader when done. */
+  };
+
+static thread_func reader_thread;
+static int64_t measure (struct throughput_test *, bool shared);
+
+void
+test_rwlock_throughput (void)
+{
+  struct throughput_test test;
+  int64_t shared_ticks, exclusive_ticks;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  shared_ticks = measure (&test, true);
+  msg ("%d reads with a reader-writer lock took %"PRId64" ticks, "
+       "with up to %d readers at once.",
+       READER_CNT * READ_CNT, shared_ticks, test.max_inside);
+  if (test.max_inside < 2)
+    fail ("readers of the reader-writer lock did not overlap");
+
+  exclusive_ticks = measure (&test, false);
+  msg ("%d reads with a lock took %"PRId64" ticks, "
+       "with up to %d readers at once.",
+       READER_CNT * READ_CNT, exclusive_ticks, test.max_inside);
+  if (test.max_inside != 1)
+    fail ("%d readers held the lock at once", test.max_inside);
+
+  if (shared_ticks * 2 > exclusive_ticks)
+    fail ("reader-writer lock is not at least twice as fast as a lock");
+  msg ("Reader-writer lock was %"PRId64" times as fast.",
+       exclusive_ticks / (shared_ticks > 0 ? shared_ticks : 1));
+}
+
+/* Runs READER_CNT readers through TEST, sharing its rwlock if
+   SHARED is true or else its lock, and returns the number of
+   ticks they took. */
+static int64_t
+measure (struct throughput_test *test, bool shared)
+{
+  int64_t start_time;
+  int i;
+
+  test->shared = shared;
+  rwlock_init (&test->rwlock);
+  lock_init (&test->lock);
+  test->inside = test->max_inside = 0;
+  sema_init (&test->done, 0);
+
+  start_time = timer_ticks ();
+  for (i = 0; i < READER_CNT; i++)
+    thread_create ("reader", PRI_DEFAULT, reader_thread, test);
+  for (i = 0; i < READER_CNT; i++)
+    sema_down (&test->done);
+  return timer_elapsed (start_time);
+}
+
+static void
+reader_thread (void *test_)
+{
+  struct throughput_test *test = test_;
+  enum intr_level old_level;
+  int i;
+
+  for (i = 0; i < READ_CNT; i++)
+    {
+      if (test->shared)
+        rwlock_acquire_read (&test->rwlock);
+      else
+        lock_acquire (&test->lock);
+
+      old_level = intr_disable ();
+      if (++test->inside > test->max_inside)
+        test->max_inside = test->inside;
+      intr_set_level (old_level);
+      timer_sleep (1);
+      old_level = intr_disable ();
+      test->inside--;
+      intr_set_level (old_level);
+
+      if (test->shared)
+        rwlock_release_read (&test->rwlock);
+      else
+        lock_release (&test->lock);
+    }
+  sema_up (&test->done);
+}
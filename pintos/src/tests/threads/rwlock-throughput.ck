@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "Reader-writer lock timing missing from output.\n"
+  if !grep (/\d+ reads with a reader-writer lock took \d+ ticks, with up to \d+ readers at once\./,
+            @output);
+fail "Lock timing missing from output.\n"
+  if !grep (/\d+ reads with a lock took \d+ ticks, with up to 1 readers at once\./,
+            @output);
+fail "Speedup missing from output.\n"
+  if !grep (/Reader-writer lock was \d+ times as fast\./, @output);
+pass;
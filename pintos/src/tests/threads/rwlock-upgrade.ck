@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-upgrade) begin
+(rwlock-upgrade) reader: got the lock
+(rwlock-upgrade) writer: acquiring for writing
+(rwlock-upgrade) main: upgrading
+(rwlock-upgrade) reader: upgrading
+(rwlock-upgrade) reader: upgrade refused
+(rwlock-upgrade) main: upgraded
+(rwlock-upgrade) This thread should have priority 33.  Actual priority: 33.
+(rwlock-upgrade) writer: got the lock
+(rwlock-upgrade) main: done
+(rwlock-upgrade) end
+EOF
+pass;
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-writer) begin
+(rwlock-writer) writer: acquiring for writing
+(rwlock-writer) This thread should have priority 33.  Actual priority: 33.
+(rwlock-writer) reader: acquiring for reading
+(rwlock-writer) main: releasing read lock
+(rwlock-writer) writer: got the lock
+(rwlock-writer) reader: got the lock
+(rwlock-writer) This thread should have priority 31.  Actual priority: 31.
+(rwlock-writer) end
+EOF
+pass;
@@ -0,0 +1,168 @@
+/* Tests reader-writer locks.
+
+   rwlock-writer checks that a reader that arrives while a
+   writer is waiting waits behind the writer, even though only
+   readers hold the lock.
+
+   rwlock-donate checks that a writer waiting for a lock held by
+   two readers donates its priority to both of them.
+
+   rwlock-upgrade checks that a reader upgrading to a writer gets
+   the lock before a writer that was already waiting, and that a
+   second reader trying to upgrade at the same time is refused. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+struct rwlock_test
+  {
+    struct rwlock rwlock;
+    struct semaphore go;        /* Upped to let a reader go on. */
+  };
+
+static thread_func writer_thread_func;
+static thread_func reader_thread_func;
+
+void
+test_rwlock_writer (void)
+{
+  struct rwlock_test test;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&test.rwlock);
+  rwlock_acquire_read (&test.rwlock);
+
+  thread_create ("writer", PRI_DEFAULT + 2, writer_thread_func, &test);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 2, thread_get_priority ());
+
+  /* Let the reader run into the waiting writer. */
+  thread_create ("reader", PRI_DEFAULT + 1, reader_thread_func, &test);
+  timer_sleep (10);
+
+  msg ("main: releasing read lock");
+  rwlock_release_read (&test.rwlock);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+writer_thread_func (void *test_)
+{
+  struct rwlock_test *test = test_;
+
+  msg ("%s: acquiring for writing", thread_name ());
+  rwlock_acquire_write (&test->rwlock);
+  msg ("%s: got the lock", thread_name ());
+  rwlock_release_write (&test->rwlock);
+}
+
+static void
+reader_thread_func (void *test_)
+{
+  struct rwlock_test *test = test_;
+
+  msg ("%s: acquiring for reading", thread_name ());
+  rwlock_acquire_read (&test->rwlock);
+  msg ("%s: got the lock", thread_name ());
+  rwlock_release_read (&test->rwlock);
+}
+
+static thread_func holding_reader_thread_func;
+
+void
+test_rwlock_donate (void)
+{
+  struct rwlock_test test;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&test.rwlock);
+  sema_init (&test.go, 0);
+
+  thread_create ("reader1", PRI_DEFAULT + 1, holding_reader_thread_func,
+                 &test);
+  thread_create ("reader2", PRI_DEFAULT + 2, holding_reader_thread_func,
+                 &test);
+  thread_create ("writer", PRI_DEFAULT + 9, writer_thread_func, &test);
+
+  sema_up (&test.go);
+  sema_up (&test.go);
+  msg ("main: done");
+}
+
+static void
+holding_reader_thread_func (void *test_)
+{
+  struct rwlock_test *test = test_;
+  int priority = thread_get_priority ();
+
+  rwlock_acquire_read (&test->rwlock);
+  msg ("%s: got the lock", thread_name ());
+  sema_down (&test->go);
+  msg ("%s should have priority %d.  Actual priority: %d.",
+       thread_name (), PRI_DEFAULT + 9, thread_get_priority ());
+  rwlock_release_read (&test->rwlock);
+  msg ("%s should have priority %d.  Actual priority: %d.",
+       thread_name (), priority, thread_get_priority ());
+}
+
+static thread_func refused_upgrader_thread_func;
+
+void
+test_rwlock_upgrade (void)
+{
+  struct rwlock_test test;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&test.rwlock);
+  sema_init (&test.go, 0);
+  rwlock_acquire_read (&test.rwlock);
+
+  thread_create ("reader", PRI_DEFAULT + 1, refused_upgrader_thread_func,
+                 &test);
+  thread_create ("writer", PRI_DEFAULT + 2, writer_thread_func, &test);
+  sema_up (&test.go);
+
+  msg ("main: upgrading");
+  if (!rwlock_upgrade (&test.rwlock))
+    fail ("main: upgrade refused");
+  msg ("main: upgraded");
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 2, thread_get_priority ());
+  rwlock_release_write (&test.rwlock);
+  msg ("main: done");
+}
+
+static void
+refused_upgrader_thread_func (void *test_)
+{
+  struct rwlock_test *test = test_;
+
+  rwlock_acquire_read (&test->rwlock);
+  msg ("%s: got the lock", thread_name ());
+  sema_down (&test->go);
+  msg ("%s: upgrading", thread_name ());
+  if (rwlock_upgrade (&test->rwlock))
+    fail ("%s: upgraded while main was upgrading", thread_name ());
+  msg ("%s: upgrade refused", thread_name ());
+  rwlock_release_read (&test->rwlock);
+}
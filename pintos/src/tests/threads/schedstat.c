@@ -0,0 +1,65 @@
+/* Checks that the scheduler statistics enabled by "-schedstat"
+   account for each kind of wait.
+
+   The main thread sleeps, waits on a semaphore, a lock, and a
+   condition variable, and has a higher-priority thread wait on
+   a lock it holds.  The statistics printed at shutdown should
+   show blocking for each of those reasons, a donation, and the
+   context switches involved. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+struct schedstat_test
+  {
+    struct semaphore sema;
+    struct lock lock;
+    struct condition cond;
+  };
+
+static thread_func helper_thread;
+
+void
+test_schedstat (void)
+{
+  struct schedstat_test test;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+  ASSERT (thread_schedstat);
+
+  sema_init (&test.sema, 0);
+  lock_init (&test.lock);
+  cond_init (&test.cond);
+
+  msg ("Sleeping.");
+  timer_sleep (5);
+
+  /* The helper runs at a lower priority whenever we block.  It
+     ups the semaphore, then takes the lock that cond_wait()
+     releases to signal the condition, so that we wait for the
+     lock while it holds it. */
+  lock_acquire (&test.lock);
+  thread_create ("helper", PRI_DEFAULT - 1, helper_thread, &test);
+  msg ("Waiting on a semaphore.");
+  sema_down (&test.sema);
+  msg ("Waiting on a condition.");
+  cond_wait (&test.cond, &test.lock);
+  lock_release (&test.lock);
+  msg ("Done.");
+}
+
+static void
+helper_thread (void *test_)
+{
+  struct schedstat_test *test = test_;
+
+  sema_up (&test->sema);
+  lock_acquire (&test->lock);
+  cond_signal (&test->cond, &test->lock);
+  lock_release (&test->lock);
+}
@@ -0,0 +1,34 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+fail "Context switch counts missing from output.\n"
+  if !grep (/^Schedstat: \d+ voluntary, \d+ involuntary context switches$/,
+            @output);
+fail "Run queue length missing from output.\n"
+  if !grep (/^Schedstat: run queue length \d+\.\d\d on average/, @output);
+fail "Donation missing from output.\n"
+  if !grep (/^Schedstat: [1-9]\d* donations/, @output);
+fail "Wakeup latency missing from output.\n"
+  if !grep (/^Schedstat: wakeup latency, at most \d+ cycles:$/, @output);
+foreach my $reason (qw (sema lock cond sleep)) {
+  fail "Blocking on $reason missing from output.\n"
+    if !grep (/^Schedstat:   $reason +[1-9]\d* times/, @output);
+}
+fail "Main thread statistics missing from output.\n"
+  if !grep (/^Schedstat: thread \d+ "main": [1-9]\d* voluntary/, @output);
+
+compare_output ("run", \@output, [<<'EOF']);
+(schedstat) begin
+(schedstat) Sleeping.
+(schedstat) Waiting on a semaphore.
+(schedstat) Waiting on a condition.
+(schedstat) Done.
+(schedstat) end
+EOF
+pass;
@@ -0,0 +1,69 @@
+/* Measures the cost of a round trip between two threads that
+   wake each other up through semaphores.
+
+   The main thread ups a semaphore that a higher-priority thread
+   is waiting on, then waits on a second semaphore that the other
+   thread ups in return before waiting again.  Every round trip
+   wakes up a higher-priority thread, which is switched to
+   directly, and blocks it again.  The number of round trips per
+   timer tick shows how cheap that path is. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of round trips. */
+#define ROUND_TRIP_CNT 20000
+
+struct pingpong
+  {
+    struct semaphore ping;      /* Upped by main thread. */
+    struct semaphore pong;      /* Upped by ponger in reply. */
+  };
+
+static thread_func ponger_thread;
+
+void
+test_sema_pingpong (void)
+{
+  struct pingpong pp;
+  int64_t start_time, elapsed;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&pp.ping, 0);
+  sema_init (&pp.pong, 0);
+  thread_create ("ponger", PRI_DEFAULT + 1, ponger_thread, &pp);
+
+  start_time = timer_ticks ();
+  for (i = 0; i < ROUND_TRIP_CNT; i++)
+    {
+      sema_up (&pp.ping);
+      sema_down (&pp.pong);
+    }
+  elapsed = timer_elapsed (start_time);
+
+  msg ("%d round trips took %"PRId64" ticks.", ROUND_TRIP_CNT, elapsed);
+  msg ("%"PRId64" round trips per tick.",
+       ROUND_TRIP_CNT / (elapsed > 0 ? elapsed : 1));
+}
+
+/* Replies to each ping with a pong. */
+static void
+ponger_thread (void *pp_)
+{
+  struct pingpong *pp = pp_;
+  int i;
+
+  for (i = 0; i < ROUND_TRIP_CNT; i++)
+    {
+      sema_down (&pp->ping);
+      sema_up (&pp->pong);
+    }
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+fail "Round trip timing missing from output.\n"
+  if !grep (/\d+ round trips took \d+ ticks\./, @output);
+fail "Round trip rate missing from output.\n"
+  if !grep (/\d+ round trips per tick\./, @output);
+pass;
@@ -0,0 +1,237 @@
+/* Tests the timed waits on semaphores, locks, and condition
+   variables.
+
+   timeout-sema checks that sema_down_timeout() gives up after
+   the given number of ticks, and that it returns as soon as the
+   semaphore is upped otherwise.
+
+   timeout-lock checks that when lock_acquire_timeout() gives
+   up, the priority it donated is taken back along the whole
+   chain of lock holders.
+
+   timeout-rwlock checks the same when the chain runs through a
+   reader-writer lock.
+
+   timeout-cond checks that cond_wait_timeout() reacquires the
+   lock whether or not it is signaled, and that a waiter that
+   timed out does not consume a later signal. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static thread_func upper_thread_func;
+
+void
+test_timeout_sema (void)
+{
+  struct semaphore sema;
+  int64_t start_time, elapsed;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&sema, 0);
+  if (sema_down_timeout (&sema, 0))
+    fail ("sema_down_timeout with 0 ticks succeeded");
+
+  msg ("Waiting 10 ticks on a semaphore nobody ups.");
+  start_time = timer_ticks ();
+  if (sema_down_timeout (&sema, 10))
+    fail ("sema_down_timeout succeeded");
+  elapsed = timer_elapsed (start_time);
+  if (elapsed < 10)
+    fail ("timed out after only %"PRId64" ticks", elapsed);
+  msg ("Timed out.");
+
+  thread_create ("upper", PRI_DEFAULT - 1, upper_thread_func, &sema);
+  msg ("Waiting up to 1000 ticks for a lower-priority thread to up it.");
+  start_time = timer_ticks ();
+  if (!sema_down_timeout (&sema, 1000))
+    fail ("sema_down_timeout timed out");
+  elapsed = timer_elapsed (start_time);
+  if (elapsed >= 1000)
+    fail ("semaphore was upped only after %"PRId64" ticks", elapsed);
+  msg ("Got the semaphore.");
+}
+
+static void
+upper_thread_func (void *sema_)
+{
+  struct semaphore *sema = sema_;
+
+  msg ("upper: upping the semaphore");
+  sema_up (sema);
+}
+
+struct lock_pair
+  {
+    struct lock *a;
+    struct lock *b;
+  };
+
+static thread_func medium_thread_func;
+static thread_func high_thread_func;
+
+void
+test_timeout_lock (void)
+{
+  struct lock a, b;
+  struct lock_pair locks;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  lock_init (&a);
+  lock_init (&b);
+  lock_acquire (&a);
+  locks.a = &a;
+  locks.b = &b;
+
+  thread_create ("medium", PRI_DEFAULT + 5, medium_thread_func, &locks);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 5, thread_get_priority ());
+  thread_create ("high", PRI_DEFAULT + 10, high_thread_func, &b);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 10, thread_get_priority ());
+
+  timer_sleep (50);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 5, thread_get_priority ());
+
+  lock_release (&a);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+medium_thread_func (void *locks_)
+{
+  struct lock_pair *locks = locks_;
+
+  lock_acquire (locks->b);
+  lock_acquire (locks->a);
+  msg ("medium: got lock a");
+  lock_release (locks->a);
+  lock_release (locks->b);
+}
+
+static void
+high_thread_func (void *lock_)
+{
+  struct lock *lock = lock_;
+
+  if (lock_acquire_timeout (lock, 20))
+    fail ("high: got lock b");
+  msg ("high: timed out");
+}
+
+struct rwlock_pair
+  {
+    struct rwlock *a;
+    struct lock *b;
+  };
+
+static thread_func rw_medium_thread_func;
+
+void
+test_timeout_rwlock (void)
+{
+  struct rwlock a;
+  struct lock b;
+  struct rwlock_pair locks;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&a);
+  lock_init (&b);
+  rwlock_acquire_read (&a);
+  locks.a = &a;
+  locks.b = &b;
+
+  thread_create ("medium", PRI_DEFAULT + 5, rw_medium_thread_func, &locks);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 5, thread_get_priority ());
+  thread_create ("high", PRI_DEFAULT + 10, high_thread_func, &b);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 10, thread_get_priority ());
+
+  timer_sleep (50);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 5, thread_get_priority ());
+
+  rwlock_release_read (&a);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+rw_medium_thread_func (void *locks_)
+{
+  struct rwlock_pair *locks = locks_;
+
+  lock_acquire (locks->b);
+  rwlock_acquire_write (locks->a);
+  msg ("medium: got rwlock a");
+  rwlock_release_write (locks->a);
+  lock_release (locks->b);
+}
+
+struct cond_test
+  {
+    struct lock lock;
+    struct condition cond;
+  };
+
+static thread_func signaler_thread_func;
+
+void
+test_timeout_cond (void)
+{
+  struct cond_test test;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  lock_init (&test.lock);
+  cond_init (&test.cond);
+  lock_acquire (&test.lock);
+
+  msg ("Waiting 10 ticks on a condition nobody signals.");
+  if (cond_wait_timeout (&test.cond, &test.lock, 10))
+    fail ("cond_wait_timeout was signaled");
+  if (!lock_held_by_current_thread (&test.lock))
+    fail ("lock not reacquired after timeout");
+  msg ("Timed out, holding the lock.");
+
+  thread_create ("signaler", PRI_DEFAULT - 1, signaler_thread_func, &test);
+  msg ("Waiting up to 1000 ticks for a signal.");
+  if (!cond_wait_timeout (&test.cond, &test.lock, 1000))
+    fail ("cond_wait_timeout timed out");
+  if (!lock_held_by_current_thread (&test.lock))
+    fail ("lock not reacquired after signal");
+  msg ("Signaled, holding the lock.");
+  lock_release (&test.lock);
+}
+
+static void
+signaler_thread_func (void *test_)
+{
+  struct cond_test *test = test_;
+
+  lock_acquire (&test->lock);
+  msg ("signaler: signaling");
+  cond_signal (&test->cond, &test->lock);
+  lock_release (&test->lock);
+}
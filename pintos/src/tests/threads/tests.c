@@ -13,10 +13,12 @@ static const struct test tests[] =
   {
     {"alarm-single", test_alarm_single},
     {"alarm-multiple", test_alarm_multiple},
+    {"alarm-multiple-tickless", test_alarm_multiple},
     {"alarm-simultaneous", test_alarm_simultaneous},
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-scale", test_alarm_scale},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -29,7 +31,32 @@ static const struct test tests[] =
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"priority-switch-10", test_priority_switch_10},
+    {"priority-switch-100", test_priority_switch_100},
+    {"priority-switch-500", test_priority_switch_500},
+    {"sema-pingpong", test_sema_pingpong},
+    {"schedstat", test_schedstat},
+    {"edf-periodic", test_edf_periodic},
+    {"edf-budget", test_edf_budget},
+    {"workqueue-fifo", test_workqueue_fifo},
+    {"workqueue-priority", test_workqueue_priority},
+    {"workqueue-delayed", test_workqueue_delayed},
+    {"cont-sema", test_cont_sema},
+    {"cont-chain", test_cont_chain},
+    {"irqtrace", test_irqtrace},
+    {"fpu-threads", test_fpu_threads},
+    {"klog", test_klog},
+    {"hrtimer", test_hrtimer},
+    {"timeout-sema", test_timeout_sema},
+    {"timeout-lock", test_timeout_lock},
+    {"timeout-rwlock", test_timeout_rwlock},
+    {"timeout-cond", test_timeout_cond},
+    {"rwlock-writer", test_rwlock_writer},
+    {"rwlock-donate", test_rwlock_donate},
+    {"rwlock-upgrade", test_rwlock_upgrade},
+    {"rwlock-throughput", test_rwlock_throughput},
     {"mlfqs-load-1", test_mlfqs_load_1},
+    {"mlfqs-load-1-tickless", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
     {"mlfqs-recent-1", test_mlfqs_recent_1},
@@ -38,6 +65,11 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"mlfqs-tickless-slice", test_mlfqs_tickless_slice},
+    {"cfs-fair-2", test_cfs_fair_2},
+    {"cfs-fair-20", test_cfs_fair_20},
+    {"cfs-nice-2", test_cfs_nice_2},
+    {"cfs-nice-10", test_cfs_nice_10},
   };
 
 static const char *test_name;
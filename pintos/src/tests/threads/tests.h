@@ -11,6 +11,7 @@ extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_priority;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_alarm_scale;
 extern test_func test_priority_change;
 extern test_func test_priority_donate_one;
 extern test_func test_priority_donate_multiple;
@@ -23,6 +24,30 @@ extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_priority_switch_10;
+extern test_func test_priority_switch_100;
+extern test_func test_priority_switch_500;
+extern test_func test_sema_pingpong;
+extern test_func test_schedstat;
+extern test_func test_edf_periodic;
+extern test_func test_edf_budget;
+extern test_func test_workqueue_fifo;
+extern test_func test_workqueue_priority;
+extern test_func test_workqueue_delayed;
+extern test_func test_cont_sema;
+extern test_func test_cont_chain;
+extern test_func test_irqtrace;
+extern test_func test_fpu_threads;
+extern test_func test_klog;
+extern test_func test_hrtimer;
+extern test_func test_timeout_sema;
+extern test_func test_timeout_lock;
+extern test_func test_timeout_rwlock;
+extern test_func test_timeout_cond;
+extern test_func test_rwlock_writer;
+extern test_func test_rwlock_donate;
+extern test_func test_rwlock_upgrade;
+extern test_func test_rwlock_throughput;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -32,6 +57,11 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_mlfqs_tickless_slice;
+extern test_func test_cfs_fair_2;
+extern test_func test_cfs_fair_20;
+extern test_func test_cfs_nice_2;
+extern test_func test_cfs_nice_10;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
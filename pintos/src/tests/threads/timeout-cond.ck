@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(timeout-cond) begin
+(timeout-cond) Waiting 10 ticks on a condition nobody signals.
+(timeout-cond) Timed out, holding the lock.
+(timeout-cond) Waiting up to 1000 ticks for a signal.
+(timeout-cond) signaler: signaling
+(timeout-cond) Signaled, holding the lock.
+(timeout-cond) end
+EOF
+pass;
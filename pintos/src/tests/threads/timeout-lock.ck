@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(timeout-lock) begin
+(timeout-lock) This thread should have priority 36.  Actual priority: 36.
+(timeout-lock) This thread should have priority 41.  Actual priority: 41.
+(timeout-lock) high: timed out
+(timeout-lock) This thread should have priority 36.  Actual priority: 36.
+(timeout-lock) medium: got lock a
+(timeout-lock) This thread should have priority 31.  Actual priority: 31.
+(timeout-lock) end
+EOF
+pass;
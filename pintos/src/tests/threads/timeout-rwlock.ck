@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(timeout-rwlock) begin
+(timeout-rwlock) This thread should have priority 36.  Actual priority: 36.
+(timeout-rwlock) This thread should have priority 41.  Actual priority: 41.
+(timeout-rwlock) high: timed out
+(timeout-rwlock) This thread should have priority 36.  Actual priority: 36.
+(timeout-rwlock) medium: got rwlock a
+(timeout-rwlock) This thread should have priority 31.  Actual priority: 31.
+(timeout-rwlock) end
+EOF
+pass;
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(timeout-sema) begin
+(timeout-sema) Waiting 10 ticks on a semaphore nobody ups.
+(timeout-sema) Timed out.
+(timeout-sema) Waiting up to 1000 ticks for a lower-priority thread to up it.
+(timeout-sema) upper: upping the semaphore
+(timeout-sema) Got the semaphore.
+(timeout-sema) end
+EOF
+pass;
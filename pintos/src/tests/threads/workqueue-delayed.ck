@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue-delayed) begin
+(workqueue-delayed) Queued work to run in 10 ticks.
+(workqueue-delayed) Queuing it again was refused.
+(workqueue-delayed) Cancelled work queued to run in 5 ticks.
+(workqueue-delayed) Work ran after at least 10 ticks.
+(workqueue-delayed) Cancelled work did not run.
+(workqueue-delayed) end
+EOF
+pass;
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue-fifo) begin
+(workqueue-fifo) work 0 ran
+(workqueue-fifo) work 1 ran
+(workqueue-fifo) work 3 ran
+(workqueue-fifo) work 4 ran
+(workqueue-fifo) end
+EOF
+pass;
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue-priority) begin
+(workqueue-priority) work 1 ran
+(workqueue-priority) work 3 ran
+(workqueue-priority) work 2 ran
+(workqueue-priority) work 0 ran
+(workqueue-priority) work 4 ran
+(workqueue-priority) end
+EOF
+pass;
@@ -0,0 +1,152 @@
+/* Tests work queues.
+
+   workqueue-fifo checks that a FIFO queue runs work in the
+   order it was queued, that cancelled work does not run, and
+   that workqueue_flush() waits for the rest.
+
+   workqueue-priority checks that a prioritized queue runs work
+   of higher priority first, and work of equal priority in the
+   order it was queued.
+
+   workqueue-delayed checks that delayed work runs no sooner
+   than its delay, that it cannot be queued twice, and that
+   cancelling it before its timeout keeps it from running. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+/* Number of work items in the FIFO and priority tests. */
+#define WORK_CNT 5
+
+/* Queue under test.  Queues cannot be destroyed, so it is
+   static. */
+static struct workqueue wq;
+
+/* Work items and the order in which they ran. */
+static struct work works[WORK_CNT];
+static int order[WORK_CNT];
+static int ran_cnt;
+
+static work_func record_work;
+static void print_order (void);
+
+void
+test_workqueue_fifo (void)
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* A worker of lower priority cannot start until we flush. */
+  workqueue_init (&wq, "fifo", 1, PRI_DEFAULT - 1, false);
+  for (i = 0; i < WORK_CNT; i++)
+    {
+      work_init (&works[i], record_work, (void *) i);
+      workqueue_queue (&wq, &works[i]);
+    }
+  if (workqueue_queue (&wq, &works[0]))
+    fail ("work 0 queued twice");
+  if (!work_cancel (&works[2]))
+    fail ("work 2 could not be cancelled");
+
+  workqueue_flush (&wq);
+  print_order ();
+}
+
+void
+test_workqueue_priority (void)
+{
+  static const int priorities[WORK_CNT] = {10, 30, 20, 30, 0};
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  workqueue_init (&wq, "priority", 1, PRI_DEFAULT - 1, true);
+  for (i = 0; i < WORK_CNT; i++)
+    {
+      work_init (&works[i], record_work, (void *) i);
+      work_set_priority (&works[i], priorities[i]);
+      workqueue_queue (&wq, &works[i]);
+    }
+
+  workqueue_flush (&wq);
+  print_order ();
+}
+
+/* Records that the work numbered WORK_ ran. */
+static void
+record_work (void *work_)
+{
+  order[ran_cnt++] = (int) work_;
+}
+
+/* Prints the order in which work ran. */
+static void
+print_order (void)
+{
+  int i;
+
+  for (i = 0; i < ran_cnt; i++)
+    msg ("work %d ran", order[i]);
+}
+
+/* Delayed work and the tick at which it ran. */
+static struct delayed_work delayed, cancelled;
+static int64_t delayed_ran;
+static bool cancelled_ran;
+
+static work_func delayed_work_func;
+static work_func cancelled_work_func;
+
+void
+test_workqueue_delayed (void)
+{
+  int64_t start_time;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  workqueue_init (&wq, "delayed", 1, PRI_DEFAULT + 1, false);
+  delayed_work_init (&delayed, delayed_work_func, NULL);
+  delayed_work_init (&cancelled, cancelled_work_func, NULL);
+
+  start_time = timer_ticks ();
+  workqueue_queue_delayed (&wq, &delayed, 10);
+  msg ("Queued work to run in 10 ticks.");
+  if (workqueue_queue_delayed (&wq, &delayed, 1))
+    fail ("work queued again while waiting");
+  msg ("Queuing it again was refused.");
+
+  workqueue_queue_delayed (&wq, &cancelled, 5);
+  if (!delayed_work_cancel (&cancelled))
+    fail ("work could not be cancelled");
+  msg ("Cancelled work queued to run in 5 ticks.");
+
+  timer_sleep (20);
+  if (delayed_ran == 0)
+    fail ("work did not run");
+  if (delayed_ran - start_time < 10)
+    fail ("work ran after only %lld ticks", delayed_ran - start_time);
+  msg ("Work ran after at least 10 ticks.");
+  if (cancelled_ran)
+    fail ("cancelled work ran");
+  msg ("Cancelled work did not run.");
+}
+
+static void
+delayed_work_func (void *aux UNUSED)
+{
+  delayed_ran = timer_ticks ();
+}
+
+static void
+cancelled_work_func (void *aux UNUSED)
+{
+  cancelled_ran = true;
+}
@@ -0,0 +1,28 @@
+/* Child process run by fpu-multi.
+   Counts from its argument in the x87 register stack for long
+   enough to be preempted many times, then exits with 81 if the
+   count came out right. */
+
+#include <stdlib.h>
+#include "tests/lib.h"
+
+/* Number of additions. */
+#define ITER_CNT 20000000
+
+int
+main (int argc, char *argv[]) 
+{
+  int start, result, i;
+
+  test_name = "child-fpu";
+  if (argc != 2)
+    fail ("argc is %d", argc);
+  start = atoi (argv[1]);
+
+  asm volatile ("fildl %0" : : "m" (start));
+  for (i = 0; i < ITER_CNT; i++)
+    asm volatile ("fld1; faddp");
+  asm volatile ("fistpl %0" : "=m" (result));
+
+  return result == start + ITER_CNT ? 81 : 1;
+}
@@ -0,0 +1,19 @@
+/* Runs two child processes at once that both keep a counter in
+   the x87 register stack while they are preempted, and checks
+   that each one's FPU state survives the other's. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  pid_t a = exec ("child-fpu 1000");
+  pid_t b = exec ("child-fpu 5000");
+  int status_a = wait (a);
+  int status_b = wait (b);
+
+  if (status_a != 81 || status_b != 81)
+    fail ("children exited with %d and %d", status_a, status_b);
+}
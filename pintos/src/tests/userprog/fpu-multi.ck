@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fpu-multi) begin
+child-fpu: exit(81)
+child-fpu: exit(81)
+(fpu-multi) end
+fpu-multi: exit(0)
+EOF
+pass;
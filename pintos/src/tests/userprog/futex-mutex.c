@@ -0,0 +1,61 @@
+/* Has several threads increment a shared counter under a mutex
+   and wait on a condition variable for all of them to finish,
+   and checks that no increment was lost.  Also checks the futex
+   system calls directly. */
+
+#include <syscall.h>
+#include <synch.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+#define ITERATIONS 20000
+
+static struct mutex mutex = MUTEX_INITIALIZER;
+static struct condition all_done = CONDITION_INITIALIZER;
+static int counter;
+static int done_cnt;
+static int word;
+
+static void
+incrementer (void *aux UNUSED)
+{
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      mutex_lock (&mutex);
+      counter++;
+      mutex_unlock (&mutex);
+    }
+
+  mutex_lock (&mutex);
+  if (++done_cnt == THREAD_CNT)
+    cond_signal (&all_done);
+  mutex_unlock (&mutex);
+}
+
+void
+test_main (void)
+{
+  int tids[THREAD_CNT];
+  int i;
+
+  CHECK (futex_wait (&word, 1) == -1, "futex_wait on changed word");
+  CHECK (futex_wake (&word, 1) == 0, "futex_wake with no waiters");
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK ((tids[i] = uthread_create (incrementer, NULL)) != -1,
+           "create thread %d", i);
+
+  mutex_lock (&mutex);
+  while (done_cnt < THREAD_CNT)
+    cond_wait (&all_done, &mutex);
+  mutex_unlock (&mutex);
+  msg ("all threads done");
+
+  for (i = 0; i < THREAD_CNT; i++)
+    uthread_join (tids[i]);
+  if (counter != THREAD_CNT * ITERATIONS)
+    fail ("counter is %d, should be %d", counter, THREAD_CNT * ITERATIONS);
+}
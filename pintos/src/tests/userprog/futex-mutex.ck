@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-mutex) begin
+(futex-mutex) futex_wait on changed word
+(futex-mutex) futex_wake with no waiters
+(futex-mutex) create thread 0
+(futex-mutex) create thread 1
+(futex-mutex) create thread 2
+(futex-mutex) create thread 3
+(futex-mutex) all threads done
+(futex-mutex) end
+futex-mutex: exit(0)
+EOF
+pass;
@@ -0,0 +1,64 @@
+/* Starts threads that spin in user mode, wait in uthread_join(),
+   and wait to read from the console, then has another thread
+   call exit() while the main thread waits in uthread_join() too.
+   The process must exit anyway, without waiting for any of them
+   to enter the kernel or be woken up on its own. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static volatile int spinning;
+static volatile int reading;
+static volatile int joining;
+static int spinner_tid;
+static int reader_tid;
+
+static void
+spinner (void *aux UNUSED)
+{
+  for (;;)
+    spinning = 1;
+}
+
+static void
+joiner (void *aux UNUSED)
+{
+  joining = 1;
+  uthread_join (spinner_tid);
+  fail ("join returned");
+}
+
+static void
+reader (void *aux UNUSED)
+{
+  char c;
+
+  reading = 1;
+  read (STDIN_FILENO, &c, 1);
+  fail ("read returned");
+}
+
+static void
+exiter (void *aux UNUSED)
+{
+  msg ("exiting");
+  exit (57);
+}
+
+void
+test_main (void)
+{
+  CHECK ((spinner_tid = uthread_create (spinner, NULL)) != -1,
+         "create spinner");
+  CHECK (uthread_create (joiner, NULL) != -1, "create joiner");
+  CHECK ((reader_tid = uthread_create (reader, NULL)) != -1,
+         "create reader");
+  while (!spinning || !joining || !reading)
+    continue;
+
+  CHECK (uthread_create (exiter, NULL) != -1, "create exiter");
+  uthread_join (reader_tid);
+  fail ("main thread's join returned");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-exit) begin
+(thread-exit) create spinner
+(thread-exit) create joiner
+(thread-exit) create reader
+(thread-exit) create exiter
+(thread-exit) exiting
+thread-exit: exit(57)
+EOF
+pass;
@@ -0,0 +1,50 @@
+/* Starts several threads in one process that all write to the
+   same pages of a large zeroed array at once, so that they fault
+   on each page together, then joins them and checks that the
+   main thread sees every thread's writes. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define THREAD_CNT 4
+#define PAGE_CNT 16
+
+static char pages[PAGE_CNT][4096];
+static int sums[THREAD_CNT];
+
+static void
+writer (void *id_)
+{
+  int id = (int) id_;
+  int i;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      pages[i][id] = id + 1;
+      sums[id] += i;
+    }
+}
+
+void
+test_main (void)
+{
+  int tids[THREAD_CNT];
+  int i, j;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK ((tids[i] = uthread_create (writer, (void *) i)) != -1,
+           "create thread %d", i);
+  for (i = 0; i < THREAD_CNT; i++)
+    CHECK (uthread_join (tids[i]) == tids[i], "join thread %d", i);
+  CHECK (uthread_join (tids[0]) == -1, "join thread 0 again");
+
+  for (i = 0; i < PAGE_CNT; i++)
+    for (j = 0; j < THREAD_CNT; j++)
+      if (pages[i][j] != j + 1)
+        fail ("page %d: thread %d's byte is %d", i, j, pages[i][j]);
+  for (j = 0; j < THREAD_CNT; j++)
+    if (sums[j] != PAGE_CNT * (PAGE_CNT - 1) / 2)
+      fail ("thread %d: sum is %d", j, sums[j]);
+  msg ("all writes seen");
+}
@@ -0,0 +1,104 @@
+#include "threads/cont.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Continuations.
+
+   A continuation takes the place of a thread blocked waiting
+   for an event: instead of a 4 kB thread, the waiter is a small
+   struct cont holding a function and a pointer to its state, so
+   any number of them can be waiting at once.  Continuations
+   that run without a work queue are kept on a single pending
+   list, protected by turning interrupts off, which is run at
+   the end of each external interrupt handler. */
+
+/* Scheduled continuations not yet run. */
+static struct list pending = LIST_INITIALIZER(pending);
+
+/* Thread running the pending list outside an interrupt handler,
+   so that a continuation that schedules another one does not
+   recurse. */
+static struct thread *runner;
+
+static work_func cont_work;
+
+/* Initializes C to call FUNC(AUX) when it runs. */
+void cont_init(struct cont *c, cont_func *func, void *aux)
+{
+    ASSERT(c != NULL);
+    ASSERT(func != NULL);
+
+    c->func = func;
+    c->aux = aux;
+    c->wq = NULL;
+    c->pending = false;
+}
+
+/* Makes C run on a worker thread of WQ, where it may sleep,
+   rather than with interrupts off.  C must not be scheduled. */
+void cont_set_workqueue(struct cont *c, struct workqueue *wq)
+{
+    ASSERT(!c->pending);
+
+    c->wq = wq;
+    work_init(&c->work, cont_work, c);
+}
+
+/* Schedules C to run, unless it is already scheduled.  May be
+   called from an interrupt handler. */
+void cont_schedule(struct cont *c)
+{
+    enum intr_level old_level;
+
+    ASSERT(c != NULL);
+
+    if (c->wq != NULL)
+    {
+        workqueue_queue(c->wq, &c->work);
+        return;
+    }
+
+    old_level = intr_disable();
+    if (!c->pending)
+    {
+        c->pending = true;
+        list_push_back(&pending, &c->elem);
+        if (!intr_context() && runner != thread_current())
+            cont_run_pending();
+    }
+    intr_set_level(old_level);
+}
+
+/* Runs the pending continuations, including any they schedule.
+   Called at the end of each external interrupt handler.
+   Interrupts must be off. */
+void cont_run_pending(void)
+{
+    struct thread *old_runner = runner;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (!intr_context())
+        runner = thread_current();
+    while (!list_empty(&pending))
+    {
+        struct cont *c = list_entry(list_pop_front(&pending),
+                                    struct cont, elem);
+
+        c->pending = false;
+        c->func(c->aux);
+        ASSERT(intr_get_level() == INTR_OFF);
+    }
+    if (!intr_context())
+        runner = old_runner;
+}
+
+/* Runs continuation C_ on a worker thread. */
+static void
+cont_work(void *c_)
+{
+    struct cont *c = c_;
+
+    c->func(c->aux);
+}
@@ -0,0 +1,35 @@
+#ifndef THREADS_CONT_H
+#define THREADS_CONT_H
+
+#include <list.h>
+#include <stdbool.h>
+#include "threads/workqueue.h"
+
+/* Called when a continuation runs. */
+typedef void cont_func(void *aux);
+
+/* A continuation: a function to call, with a pointer to its
+   state, once some event happens, without a thread waiting for
+   it.
+
+   By default it runs with interrupts off and must not sleep: at
+   the end of the external interrupt handler that scheduled it,
+   or right away if it was scheduled outside an interrupt
+   handler.  A continuation given a work queue instead runs on
+   one of its worker threads, where it may sleep. */
+struct cont
+{
+    cont_func *func;        /* Function to call. */
+    void *aux;              /* State for FUNC. */
+    struct workqueue *wq;   /* Queue to run on, or null. */
+    struct work work;       /* Work for running on WQ. */
+    bool pending;           /* Scheduled and not yet run? */
+    struct list_elem elem;  /* Pending list or semaphore element. */
+};
+
+void cont_init(struct cont *, cont_func *, void *aux);
+void cont_set_workqueue(struct cont *, struct workqueue *);
+void cont_schedule(struct cont *);
+void cont_run_pending(void);
+
+#endif /* threads/cont.h */
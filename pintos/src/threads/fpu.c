@@ -0,0 +1,225 @@
+#include "threads/fpu.h"
+#include <debug.h>
+#include <round.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+
+/* Lazy x87/SSE state switching.
+
+   The FPU, including the SSE registers, holds the state of at
+   most one thread, its owner.  Switching to any other thread
+   sets CR0.TS, so that the first FPU or SSE instruction that
+   thread executes raises #NM.  The #NM handler then saves the
+   owner's state, loads the running thread's, and makes it the
+   owner.  Threads that never use the FPU never pay for it, and
+   have no save area: it is allocated at a thread's first
+   #NM.
+
+   Kernel code is compiled with -msoft-float, so it uses the FPU
+   only through explicit assembly.  It must not do so in an
+   external interrupt handler, because the #NM handler may
+   sleep to allocate a save area. */
+
+/* CR0 bits.  See [IA32-v3a] 2.5 "Control Registers". */
+#define CR0_MP 0x00000002 /* Monitor Coprocessor. */
+#define CR0_EM 0x00000004 /* (Floating-point) Emulation. */
+#define CR0_TS 0x00000008 /* Task Switched. */
+#define CR0_NE 0x00000020 /* Numeric Error. */
+
+/* CR4 bits. */
+#define CR4_OSFXSR 0x00000200     /* FXSAVE, FXRSTOR, and SSE. */
+#define CR4_OSXMMEXCPT 0x00000400 /* SSE exceptions raise #XF. */
+
+/* CPUID.1:EDX feature bits. */
+#define CPUID_FXSR (1u << 24) /* FXSAVE and FXRSTOR. */
+#define CPUID_SSE (1u << 25)  /* SSE. */
+
+/* Size and alignment of a save area.  FXSAVE needs 512 bytes on
+   a 16-byte boundary; FNSAVE needs only 108. */
+#define FPU_SAVE_SIZE 512
+#define FPU_SAVE_ALIGN 16
+
+/* Initial MXCSR: all SSE exceptions masked, round to nearest. */
+#define MXCSR_DEFAULT 0x1f80
+
+static struct thread *fpu_owner; /* Thread whose state is loaded. */
+static bool fpu_fxsr;            /* Use FXSAVE rather than FNSAVE? */
+static bool fpu_sse;             /* SSE available and enabled? */
+static bool fpu_ts;              /* Is CR0.TS set? */
+
+/* Statistics. */
+static long long nm_cnt;    /* # of #NM exceptions. */
+static long long save_cnt;  /* # of states saved. */
+static long long alloc_cnt; /* # of save areas allocated. */
+
+static intr_handler_func nm_handler;
+static void *save_area(struct thread *);
+static void set_ts(bool);
+
+static inline uint32_t
+read_cr0(void)
+{
+    uint32_t cr0;
+    asm volatile("movl %%cr0, %0"
+                 : "=r"(cr0));
+    return cr0;
+}
+
+static inline void
+write_cr0(uint32_t cr0)
+{
+    asm volatile("movl %0, %%cr0"
+                 :
+                 : "r"(cr0));
+}
+
+/* Enables the FPU, and SSE if the CPU has it, with lazy state
+   switching, and registers the #NM handler. */
+void fpu_init(void)
+{
+    uint32_t eax, ebx, ecx, edx;
+
+    /* See [IA32-v2a] "CPUID". */
+    asm volatile("cpuid"
+                 : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+                 : "a"(1));
+    fpu_fxsr = (edx & CPUID_FXSR) != 0;
+    fpu_sse = fpu_fxsr && (edx & CPUID_SSE) != 0;
+    if (fpu_sse)
+    {
+        uint32_t cr4;
+        asm volatile("movl %%cr4, %0"
+                     : "=r"(cr4));
+        cr4 |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+        asm volatile("movl %0, %%cr4"
+                     :
+                     : "r"(cr4));
+    }
+
+    /* No thread owns the FPU yet, so the first use traps. */
+    write_cr0((read_cr0() & ~CR0_EM) | CR0_MP | CR0_NE | CR0_TS);
+    fpu_ts = true;
+
+    intr_register_int(7, 0, INTR_OFF, nm_handler,
+                      "#NM Device Not Available Exception");
+}
+
+/* Called by the scheduler when switching to thread T, with
+   interrupts off.  Lets T use the FPU directly only if its state
+   is the one loaded. */
+void fpu_switch(struct thread *t)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    set_ts(t != fpu_owner);
+}
+
+/* Releases the running thread's FPU state, as it exits. */
+void fpu_exit(void)
+{
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+    void *fpu;
+
+    old_level = intr_disable();
+    if (fpu_owner == cur)
+    {
+        fpu_owner = NULL;
+        set_ts(true);
+    }
+    fpu = cur->fpu;
+    cur->fpu = NULL;
+    intr_set_level(old_level);
+
+    free(fpu);
+}
+
+/* Prints FPU statistics, if any thread used the FPU. */
+void fpu_print_stats(void)
+{
+    if (nm_cnt == 0)
+        return;
+    printf("FPU: %lld traps, %lld saves, %lld save areas allocated\n",
+           nm_cnt, save_cnt, alloc_cnt);
+}
+
+/* #NM handler: makes the running thread the owner of the FPU. */
+static void
+nm_handler(struct intr_frame *f UNUSED)
+{
+    struct thread *cur = thread_current();
+    bool fresh = cur->fpu == NULL;
+
+    nm_cnt++;
+
+    /* This may sleep, after which the scheduler has set CR0.TS
+       again, so do it before touching the FPU. */
+    if (fresh)
+    {
+        cur->fpu = malloc(FPU_SAVE_SIZE + FPU_SAVE_ALIGN - 1);
+        if (cur->fpu == NULL)
+            PANIC("out of memory for FPU state of thread %s", cur->name);
+        alloc_cnt++;
+    }
+
+    set_ts(false);
+    if (fpu_owner == cur)
+        return;
+
+    if (fpu_owner != NULL)
+    {
+        /* See [IA32-v2a] "FXSAVE" and "FNSAVE". */
+        if (fpu_fxsr)
+            asm volatile("fxsave %0"
+                         : "=m"(*(char(*)[FPU_SAVE_SIZE])save_area(fpu_owner)));
+        else
+            asm volatile("fnsave %0"
+                         : "=m"(*(char(*)[FPU_SAVE_SIZE])save_area(fpu_owner)));
+        save_cnt++;
+    }
+
+    if (fresh)
+    {
+        uint32_t mxcsr = MXCSR_DEFAULT;
+
+        asm volatile("fninit");
+        if (fpu_sse)
+            asm volatile("ldmxcsr %0"
+                         :
+                         : "m"(mxcsr));
+    }
+    else if (fpu_fxsr)
+        asm volatile("fxrstor %0"
+                     :
+                     : "m"(*(char(*)[FPU_SAVE_SIZE])save_area(cur)));
+    else
+        asm volatile("frstor %0"
+                     :
+                     : "m"(*(char(*)[FPU_SAVE_SIZE])save_area(cur)));
+    fpu_owner = cur;
+}
+
+/* Returns T's save area, aligned as FXSAVE requires. */
+static void *
+save_area(struct thread *t)
+{
+    return (void *)ROUND_UP((uintptr_t)t->fpu, FPU_SAVE_ALIGN);
+}
+
+/* Sets CR0.TS if TS is true, or clears it, unless it already has
+   that value. */
+static void
+set_ts(bool ts)
+{
+    if (ts == fpu_ts)
+        return;
+    fpu_ts = ts;
+    if (ts)
+        write_cr0(read_cr0() | CR0_TS);
+    else
+        asm volatile("clts");
+}
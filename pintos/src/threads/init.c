@@ -15,13 +15,17 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/klog.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/tsc.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -61,6 +65,17 @@ static const char *swap_bdev_name;
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+/* Boot phases, timed with the time-stamp counter. */
+#define BOOT_PHASES_MAX 8
+struct boot_phase
+{
+    const char *name; /* Name, for the report. */
+    uint64_t end;     /* TSC at the end of the phase. */
+};
+static struct boot_phase boot_phases[BOOT_PHASES_MAX];
+static int boot_phase_cnt;
+static uint64_t boot_start; /* TSC at entry to main(). */
+
 static void bss_init(void);
 static void paging_init(void);
 
@@ -68,6 +83,8 @@ static char **read_command_line(void);
 static char **parse_options(char **argv);
 static void run_actions(char **argv);
 static void usage(void);
+static void boot_phase_done(const char *name);
+static void print_boot_times(void);
 
 #ifdef FILESYS
 static void locate_block_devices(void);
@@ -83,6 +100,7 @@ int main(void)
 
     /* Clear BSS. */
     bss_init();
+    boot_start = rdtsc();
 
     /* Break command line into arguments and parse options. */
     argv = read_command_line();
@@ -101,6 +119,7 @@ int main(void)
     palloc_init(user_page_limit);
     malloc_init();
     paging_init();
+    boot_phase_done("memory");
 
     /* Segmentation. */
 #ifdef USERPROG
@@ -110,6 +129,7 @@ int main(void)
 
     /* Initialize interrupt handlers. */
     intr_init();
+    fpu_init();
     timer_init();
     kbd_init();
     input_init();
@@ -118,24 +138,34 @@ int main(void)
     syscall_init();
     lock_init (&vm_destroy_lock);
 #endif
+    boot_phase_done("interrupts");
 
     /* Start thread scheduler and enable interrupts. */
     thread_start();
+    workqueue_start();
+    klog_init();
     serial_init_queue();
+    boot_phase_done("threads");
     timer_calibrate();
+    boot_phase_done("timer");
 
 #ifdef FILESYS
     /* Initialize file system. */
+    block_init();
     ide_init();
     locate_block_devices();
+    boot_phase_done("disks");
     filesys_init(format_filesys);
+    boot_phase_done("file system");
 #endif
 
 #ifdef VM
     frame_init ();
     swap_init ();
+    boot_phase_done("vm");
 #endif
 
+    print_boot_times();
     printf("Boot complete.\n");
 
     /* Run actions specified on kernel command line. */
@@ -267,6 +297,33 @@ parse_options(char **argv)
             random_init(atoi(value));
         else if (!strcmp(name, "-mlfqs"))
             thread_mlfqs = true;
+        else if (!strcmp(name, "-cfs"))
+            thread_cfs = true;
+        else if (!strcmp(name, "-tickless"))
+            timer_tickless = true;
+        else if (!strcmp(name, "-tsc-khz"))
+        {
+            timer_tsc_khz = atoi(value);
+            if (timer_tsc_khz <= 0)
+                PANIC("-tsc-khz must be positive");
+        }
+        else if (!strcmp(name, "-schedstat"))
+            thread_schedstat = true;
+        else if (!strcmp(name, "-irqtrace"))
+            intr_trace = true;
+        else if (!strcmp(name, "-serial-buf"))
+        {
+            serial_buf_kb = atoi(value);
+            if (serial_buf_kb <= 0)
+                PANIC("-serial-buf must be positive");
+        }
+        else if (!strcmp(name, "-serial-drop"))
+            serial_drop = true;
+        else if (!strcmp(name, "-klog"))
+        {
+            if (value == NULL || !klog_parse_level(value, &klog_console_level))
+                PANIC("unknown kernel log level \"%s\"", value);
+        }
 #ifdef USERPROG
         else if (!strcmp(name, "-ul"))
             user_page_limit = atoi(value);
@@ -274,6 +331,8 @@ parse_options(char **argv)
         else
             PANIC("unknown option `%s' (use -h for help)", name);
     }
+    if (thread_mlfqs && thread_cfs)
+        PANIC("-mlfqs and -cfs cannot be used together");
 
     /* Initialize the random number generator based on the system
      time.  This has no effect if an "-rs" option was specified.
@@ -303,6 +362,43 @@ run_task(char **argv)
     printf("Execution of '%s' complete.\n", task);
 }
 
+/* Prints the kernel log. */
+static void
+run_dmesg(char **argv UNUSED)
+{
+    klog_flush();
+    klog_dump();
+}
+
+/* Records that the boot phase called NAME ends now. */
+static void
+boot_phase_done(const char *name)
+{
+    ASSERT(boot_phase_cnt < BOOT_PHASES_MAX);
+
+    boot_phases[boot_phase_cnt].name = name;
+    boot_phases[boot_phase_cnt].end = rdtsc();
+    boot_phase_cnt++;
+}
+
+/* Prints how long the boot phases took. */
+static void
+print_boot_times(void)
+{
+    uint64_t start = boot_start;
+    int i;
+
+    printf("Boot took %'" PRIu64 " us:",
+           timer_tsc_to_ns(rdtsc() - boot_start) / 1000);
+    for (i = 0; i < boot_phase_cnt; i++)
+    {
+        printf("%s %s %'" PRIu64, i > 0 ? "," : "", boot_phases[i].name,
+               timer_tsc_to_ns(boot_phases[i].end - start) / 1000);
+        start = boot_phases[i].end;
+    }
+    printf(".\n");
+}
+
 /* Executes all of the actions specified in ARGV[]
    up to the null pointer sentinel. */
 static void
@@ -320,6 +416,7 @@ run_actions(char **argv)
     static const struct action actions[] =
         {
             {"run", 2, run_task},
+            {"dmesg", 1, run_dmesg},
 #ifdef FILESYS
             {"ls", 1, fsutil_ls},
             {"cat", 2, fsutil_cat},
@@ -367,6 +464,7 @@ usage(void)
 #else
            "  run TEST           Run TEST.\n"
 #endif
+           "  dmesg              Print the kernel log.\n"
 #ifdef FILESYS
            "  ls                 List files in the root directory.\n"
            "  cat FILE           Print FILE to the console.\n"
@@ -389,6 +487,15 @@ usage(void)
 #endif
            "  -rs=SEED           Set random number seed to SEED.\n"
            "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+           "  -cfs               Use completely fair scheduler.\n"
+           "  -tickless          Stop the periodic timer while idle.\n"
+           "  -tsc-khz=KHZ       Use a KHZ kHz TSC instead of measuring it.\n"
+           "  -schedstat         Print scheduler statistics at shutdown.\n"
+           "  -irqtrace          Time sections with interrupts off.\n"
+           "  -serial-buf=KB     Buffer KB kB of serial output (default 16).\n"
+           "  -serial-drop       Drop serial output when its buffer is full.\n"
+           "  -klog=LEVEL        Print kernel log records up to LEVEL: error,\n"
+           "                     warning, info (default), or debug.\n"
 #ifdef USERPROG
            "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
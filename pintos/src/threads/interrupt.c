@@ -3,12 +3,17 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include "threads/cont.h"
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
 #include "threads/thread.h"
+#include "threads/tsc.h"
 #include "threads/vaddr.h"
 #include "devices/timer.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#endif
 
 /* Programmable Interrupt Controller (PIC) registers.
    A PC has two PICs, called the master and slave PICs, with the
@@ -47,6 +52,50 @@ static unsigned int unexpected_cnt[INTR_CNT];
 static bool in_external_intr; /* Are we processing an external interrupt? */
 static bool yield_on_return;  /* Should we yield on interrupt return? */
 
+/* Interrupts-off tracing, enabled with "-irqtrace".
+
+   intr_disable() notes the time-stamp counter and its caller
+   when it turns interrupts off, and intr_enable() measures how
+   long they stayed off when it turns them back on.  Entering an
+   external interrupt handler counts as turning interrupts off,
+   and returning from it as turning them back on.  A section may
+   span a context switch, since the scheduler runs with
+   interrupts off; it is charged to whoever turned them off. */
+bool intr_trace;
+
+/* An interrupts-off section. */
+struct intr_off
+{
+    uint64_t cycles;       /* Length in TSC cycles. */
+    const void *disabler;  /* Code that turned interrupts off. */
+    const void *enabler;   /* Code that turned them on, or null
+                              for a return from interrupt. */
+};
+
+/* Longest sections, longest first. */
+#define INTR_OFF_TOP 10
+static struct intr_off off_top[INTR_OFF_TOP];
+
+/* Section lengths.  Bucket I counts lengths of less than
+   2**(OFF_SHIFT + I) cycles, and at least half that, except that
+   bucket 0 counts all shorter ones and the last bucket all
+   longer ones. */
+#define OFF_SHIFT 8
+#define OFF_BUCKETS 20
+static long long off_hist[OFF_BUCKETS];
+static long long off_cnt;
+static uint64_t off_cycles;
+
+/* Section in progress. */
+static bool off_tracing;       /* Is a section being timed? */
+static uint64_t off_start;     /* When it started. */
+static const void *off_caller; /* Who started it. */
+
+static void trace_off(const void *disabler);
+static void trace_on(const void *enabler);
+static enum intr_level enable(const void *caller);
+static enum intr_level disable(const void *caller);
+
 /* Programmable Interrupt Controller helpers. */
 static void pic_init(void);
 static void pic_end_of_interrupt(int irq);
@@ -81,16 +130,36 @@ intr_get_level(void)
 enum intr_level
 intr_set_level(enum intr_level level)
 {
-    return level == INTR_ON ? intr_enable() : intr_disable();
+    const void *caller = __builtin_return_address(0);
+
+    return level == INTR_ON ? enable(caller) : disable(caller);
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_enable(void)
+{
+    return enable(__builtin_return_address(0));
+}
+
+/* Disables interrupts and returns the previous interrupt status. */
+enum intr_level
+intr_disable(void)
+{
+    return disable(__builtin_return_address(0));
+}
+
+/* Enables interrupts on behalf of CALLER and returns the
+   previous interrupt status. */
+static enum intr_level
+enable(const void *caller)
 {
     enum intr_level old_level = intr_get_level();
     ASSERT(!intr_context());
 
+    if (intr_trace && old_level == INTR_OFF)
+        trace_on(caller);
+
     /* Enable interrupts by setting the interrupt flag.
 
      See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -100,9 +169,10 @@ intr_enable(void)
     return old_level;
 }
 
-/* Disables interrupts and returns the previous interrupt status. */
-enum intr_level
-intr_disable(void)
+/* Disables interrupts on behalf of CALLER and returns the
+   previous interrupt status. */
+static enum intr_level
+disable(const void *caller)
 {
     enum intr_level old_level = intr_get_level();
 
@@ -114,9 +184,99 @@ intr_disable(void)
                  :
                  : "memory");
 
+    if (intr_trace && old_level == INTR_ON)
+        trace_off(caller);
+
     return old_level;
 }
 
+/* Ends the interrupts-off section in progress, if any, because
+   the caller is about to turn interrupts on without calling
+   intr_enable(), as the idle thread does.  Interrupts must be
+   off. */
+void intr_trace_end(void)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (intr_trace)
+        trace_on(__builtin_return_address(0));
+}
+
+/* Starts timing an interrupts-off section on behalf of
+   DISABLER.  Interrupts must be off. */
+static void
+trace_off(const void *disabler)
+{
+    if (off_tracing)
+        return;
+    off_tracing = true;
+    off_caller = disabler;
+    off_start = rdtsc();
+}
+
+/* Ends the interrupts-off section in progress, if any, on
+   behalf of ENABLER, and records it.  Interrupts must be
+   off. */
+static void
+trace_on(const void *enabler)
+{
+    uint64_t cycles;
+    int bucket, i;
+
+    if (!off_tracing)
+        return;
+    off_tracing = false;
+    cycles = rdtsc() - off_start;
+
+    off_cnt++;
+    off_cycles += cycles;
+    for (bucket = 0; bucket < OFF_BUCKETS - 1; bucket++)
+        if (cycles < (uint64_t)1 << (OFF_SHIFT + bucket))
+            break;
+    off_hist[bucket]++;
+
+    /* Insert into the longest sections, if it is long enough. */
+    if (cycles <= off_top[INTR_OFF_TOP - 1].cycles)
+        return;
+    for (i = INTR_OFF_TOP - 1; i > 0 && off_top[i - 1].cycles < cycles; i--)
+        off_top[i] = off_top[i - 1];
+    off_top[i].cycles = cycles;
+    off_top[i].disabler = off_caller;
+    off_top[i].enabler = enabler;
+}
+
+/* Prints interrupts-off statistics, if they were collected. */
+void intr_print_stats(void)
+{
+    int i;
+
+    if (!intr_trace)
+        return;
+
+    /* Stop tracing, so that printing does not change what is
+       being printed. */
+    intr_trace = false;
+
+    printf("Interrupts off: %lld sections, %llu cycles on average\n",
+           off_cnt, off_cnt > 0 ? off_cycles / off_cnt : 0);
+    for (i = 0; i < OFF_BUCKETS; i++)
+        if (off_hist[i] > 0)
+            printf("Interrupts off:   %s %8llu cycles: %lld\n",
+                   i < OFF_BUCKETS - 1 ? "<" : ">=",
+                   (uint64_t)1 << (OFF_SHIFT + (i < OFF_BUCKETS - 1 ? i : i - 1)),
+                   off_hist[i]);
+    printf("Interrupts off: longest sections:\n");
+    for (i = 0; i < INTR_OFF_TOP && off_top[i].cycles > 0; i++)
+    {
+        printf("Interrupts off:   %8llu cycles, off at %p, on at ",
+               off_top[i].cycles, off_top[i].disabler);
+        if (off_top[i].enabler != NULL)
+            printf("%p\n", off_top[i].enabler);
+        else
+            printf("interrupt return\n");
+    }
+}
+
 /* Initializes the interrupt system. */
 void intr_init(void)
 {
@@ -359,6 +519,8 @@ void intr_handler(struct intr_frame *frame)
 
         in_external_intr = true;
         yield_on_return = false;
+        if (intr_trace)
+            trace_off((const void *)intr_handlers[frame->vec_no]);
     }
 
     /* Invoke the interrupt's handler. */
@@ -380,12 +542,32 @@ void intr_handler(struct intr_frame *frame)
         ASSERT(intr_get_level() == INTR_OFF);
         ASSERT(intr_context());
 
+        /* Run the continuations that the handler scheduled while
+           still in interrupt context, so that they cannot sleep. */
+        cont_run_pending();
+
         in_external_intr = false;
         pic_end_of_interrupt(frame->vec_no);
 
         if (yield_on_return)
             thread_yield();
+
+        /* The interrupted code runs with interrupts on again. */
+        if (intr_trace)
+            trace_on(NULL);
+    }
+
+#ifdef USERPROG
+    /* Another thread has exited the process.  Checking on every
+     return to user mode, including from the timer interrupt,
+     also stops threads that never enter the kernel on their
+     own. */
+    if (frame->cs == SEL_UCSEG && thread_current()->leader->exiting)
+    {
+        intr_enable();
+        thread_exit();
     }
+#endif
 }
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
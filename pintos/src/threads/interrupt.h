@@ -64,6 +64,12 @@ void intr_register_int(uint8_t vec, int dpl, enum intr_level,
 bool intr_context(void);
 void intr_yield_on_return(void);
 
+/* If true, time the sections of code that run with interrupts
+   off.  Controlled by kernel command-line option "-irqtrace". */
+extern bool intr_trace;
+void intr_trace_end(void);
+void intr_print_stats(void);
+
 void intr_dump_frame(const struct intr_frame *);
 const char *intr_name(uint8_t vec);
 
@@ -0,0 +1,255 @@
+#include "threads/klog.h"
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Kernel log.
+
+   klog() formats its message on the caller's stack and then
+   copies it into the next slot of a ring of fixed-size records,
+   overwriting the oldest record if the ring is full.  Claiming
+   and filling the slot happens with interrupts off, which takes
+   no lock and never sleeps, so it is safe from interrupt
+   handlers and the scheduler.  Writing to the console, which is
+   slow, is left to the "klogd" thread, which copies records out
+   of the ring one at a time and prints them.  Records that are
+   overwritten before klogd gets to them are lost to the console,
+   but records that klogd has printed stay in the ring until
+   overwritten, so the log can be read back with klog_read() or
+   klog_dump() afterward.
+
+   klog() wakes up klogd, except with interrupts off outside an
+   interrupt handler, which could be in the middle of the
+   scheduler.  It then arms a timeout instead, which wakes up
+   klogd from the next timer interrupt. */
+
+/* Pages in the ring. */
+#define KLOG_PAGES 16
+
+/* Ring of records, or null before klog_init(), when klog()
+   prints directly to the console. */
+static struct klog_record *ring;
+static uint32_t ring_size;
+
+/* Sequence number of the next record to write. */
+static uint32_t next_seq;
+
+/* Sequence number of the next record to print. */
+static uint32_t print_seq;
+
+/* Upped for klogd when there are records to print. */
+static struct semaphore avail;
+
+/* Ups `avail' from the timer interrupt, for records written
+   where klog() could not do so itself. */
+static struct timeout wake_timeout;
+
+/* True after a panic: print records as they are written. */
+static bool sync_mode;
+
+enum klog_level klog_console_level = KLOG_INFO;
+
+/* Statistics. */
+static long long lost_cnt; /* # of records overwritten unread. */
+
+/* Names of levels, for the console and -klog. */
+static const char *level_names[] = {"error", "warning", "info", "debug"};
+
+static thread_func klogd NO_RETURN;
+static timeout_func wake_klogd;
+static bool take_record(struct klog_record *);
+static void print_record(const struct klog_record *);
+
+/* Allocates the log ring and starts the thread that prints the
+   log to the console.  Must be called after thread_start(). */
+void klog_init(void)
+{
+    ring = palloc_get_multiple(PAL_ASSERT, KLOG_PAGES);
+    ring_size = KLOG_PAGES * PGSIZE / sizeof *ring;
+    sema_init(&avail, 0);
+    timeout_init(&wake_timeout, wake_klogd, NULL);
+
+    if (thread_create("klogd", PRI_DEFAULT, klogd, NULL) == TID_ERROR)
+        PANIC("can't start klogd");
+}
+
+/* Adds a message at the given LEVEL to the kernel log, formatted
+   as by printf().  Never sleeps, so it may be called from any
+   context, including interrupt handlers. */
+void klog(enum klog_level level, const char *format, ...)
+{
+    struct klog_record r;
+    enum intr_level old_level;
+    va_list args;
+    size_t len;
+
+    ASSERT(level >= KLOG_ERR && level <= KLOG_DEBUG);
+
+    va_start(args, format);
+    vsnprintf(r.msg, sizeof r.msg, format, args);
+    va_end(args);
+    len = strlen(r.msg);
+    if (len > 0 && r.msg[len - 1] == '\n')
+        r.msg[len - 1] = '\0';
+    r.level = level;
+    r.time = timer_ticks();
+
+    if (ring == NULL || sync_mode)
+    {
+        r.seq = next_seq++;
+        if (level <= klog_console_level)
+            print_record(&r);
+        return;
+    }
+
+    old_level = intr_disable();
+    r.seq = next_seq++;
+    memcpy(&ring[r.seq % ring_size], &r,
+           offsetof(struct klog_record, msg) + len + 1);
+    intr_set_level(old_level);
+
+    if (level <= klog_console_level)
+    {
+        if (old_level == INTR_ON || intr_context())
+            sema_up(&avail);
+        else if (!wake_timeout.pending)
+            timeout_arm(&wake_timeout, timer_ticks() + 1);
+    }
+}
+
+/* Copies the oldest record in the log whose sequence number is
+   *SEQ or greater into *R, and advances *SEQ past it.  Returns
+   false, without changing anything, if there is no such
+   record. */
+bool klog_read(uint32_t *seq, struct klog_record *r)
+{
+    enum intr_level old_level;
+    bool found = false;
+
+    old_level = intr_disable();
+    if (ring != NULL)
+    {
+        uint32_t oldest = next_seq > ring_size ? next_seq - ring_size : 0;
+
+        if (*seq < oldest)
+            *seq = oldest;
+        if (*seq < next_seq)
+        {
+            *r = ring[*seq % ring_size];
+            ++*seq;
+            found = true;
+        }
+    }
+    intr_set_level(old_level);
+
+    return found;
+}
+
+/* Prints the records in the log that klogd has not printed
+   yet. */
+void klog_flush(void)
+{
+    struct klog_record r;
+
+    while (take_record(&r))
+        if (r.level <= klog_console_level)
+            print_record(&r);
+}
+
+/* Called on a kernel panic: prints what klogd has not printed
+   yet, and from now on has klog() print records right away,
+   since klogd will not run again. */
+void klog_panic(void)
+{
+    if (sync_mode)
+        return;
+    sync_mode = true;
+    klog_flush();
+}
+
+/* Prints every record still in the log, at any level. */
+void klog_dump(void)
+{
+    struct klog_record r;
+    uint32_t seq = 0;
+
+    while (klog_read(&seq, &r))
+        print_record(&r);
+}
+
+/* Prints kernel log statistics. */
+void klog_print_stats(void)
+{
+    printf("Kernel log: %" PRIu32 " records, %lld overwritten before "
+           "printing\n",
+           next_seq, lost_cnt);
+}
+
+/* Sets *LEVEL to the level named NAME and returns true, or
+   returns false if there is no such level. */
+bool klog_parse_level(const char *name, enum klog_level *level)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof level_names / sizeof *level_names; i++)
+        if (!strcmp(name, level_names[i]))
+        {
+            *level = i;
+            return true;
+        }
+    return false;
+}
+
+/* Thread that prints the log to the console. */
+static void
+klogd(void *aux UNUSED)
+{
+    for (;;)
+    {
+        sema_down(&avail);
+        klog_flush();
+    }
+}
+
+/* Timeout function that wakes up klogd. */
+static void
+wake_klogd(void *aux UNUSED)
+{
+    sema_up(&avail);
+}
+
+/* Takes the oldest record not printed yet out of the log into
+   *R.  Returns false if there is none. */
+static bool
+take_record(struct klog_record *r)
+{
+    enum intr_level old_level;
+    uint32_t seq;
+    bool found;
+
+    old_level = intr_disable();
+    seq = print_seq;
+    found = klog_read(&print_seq, r);
+    if (found)
+        lost_cnt += r->seq - seq;
+    intr_set_level(old_level);
+
+    return found;
+}
+
+/* Prints R to the console. */
+static void
+print_record(const struct klog_record *r)
+{
+    printf("[%5lld.%02lld] %s: %s\n",
+           r->time / TIMER_FREQ, r->time % TIMER_FREQ * 100 / TIMER_FREQ,
+           level_names[r->level], r->msg);
+}
@@ -0,0 +1,42 @@
+#ifndef THREADS_KLOG_H
+#define THREADS_KLOG_H
+
+#include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Severity of a kernel log record, most severe first. */
+enum klog_level
+{
+    KLOG_ERR,   /* Error. */
+    KLOG_WARN,  /* Warning. */
+    KLOG_INFO,  /* Informational. */
+    KLOG_DEBUG  /* Debugging, kept in the log only by default. */
+};
+
+/* Longest message kept, including the null terminator.  Longer
+   messages are truncated. */
+#define KLOG_MSG_MAX 112
+
+/* A kernel log record. */
+struct klog_record
+{
+    uint32_t seq;              /* Sequence number, from 0. */
+    enum klog_level level;     /* Severity. */
+    int64_t time;              /* Timer ticks since boot. */
+    char msg[KLOG_MSG_MAX];    /* Message, without trailing new-line. */
+};
+
+/* Least severe level printed to the console. */
+extern enum klog_level klog_console_level;
+
+void klog_init(void);
+void klog(enum klog_level, const char *format, ...) PRINTF_FORMAT(2, 3);
+bool klog_read(uint32_t *seq, struct klog_record *);
+void klog_flush(void);
+void klog_panic(void);
+void klog_dump(void);
+void klog_print_stats(void);
+bool klog_parse_level(const char *, enum klog_level *);
+
+#endif /* threads/klog.h */
@@ -0,0 +1,184 @@
+#include "threads/schedstat.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "threads/tsc.h"
+
+/* Scheduler statistics, collected only with "-o schedstat".
+
+   The scheduler calls in here when a thread blocks, is woken up,
+   or is switched away from, on each timer tick, and when a
+   thread donates its priority.  All of these run with interrupts
+   off, which protects the counters below.  Durations are
+   measured with the time-stamp counter, because most wakeups are
+   served well within a single timer tick. */
+
+bool thread_schedstat;
+
+/* Names of wait reasons, for printing. */
+static const char *wait_reason_names[WAIT_REASON_CNT] = {
+    "other", "sema", "lock", "cond", "rwlock", "sleep", "io", "period",
+};
+
+/* Context switches. */
+static long long voluntary_cnt;   /* Switches away while blocking. */
+static long long involuntary_cnt; /* Switches away while ready. */
+
+/* Wakeup-to-run latency histogram.  Bucket I counts latencies
+   of less than 2**(LATENCY_SHIFT + I) cycles, and at least half
+   that, except that bucket 0 counts all shorter ones and the
+   last bucket all longer ones. */
+#define LATENCY_SHIFT 10
+#define LATENCY_BUCKETS 16
+static long long latency_hist[LATENCY_BUCKETS];
+static uint64_t latency_max;
+
+/* Run queue length, sampled at each timer tick. */
+static long long ready_samples;
+static long long ready_sum;
+static int ready_max;
+
+/* Donations, by the number of threads whose priority each one
+   raised. */
+static long long donation_cnt;
+static long long donation_depth_sum;
+static int donation_depth_max;
+
+/* Blocking, by wait reason. */
+static long long block_cnt[WAIT_REASON_CNT];
+static uint64_t block_cycles[WAIT_REASON_CNT];
+
+static thread_action_func print_thread;
+
+/* Records that T, the running thread, is about to block waiting
+   for REASON. */
+void schedstat_block(struct thread *t, enum wait_reason reason)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(reason < WAIT_REASON_CNT);
+
+    t->sched.since = rdtsc();
+    t->sched.reason = reason;
+    t->sched.blocked = true;
+}
+
+/* Records that blocked thread T was woken up, or that new
+   thread T was made ready for the first time. */
+void schedstat_wakeup(struct thread *t)
+{
+    uint64_t now = rdtsc();
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (t->sched.blocked)
+    {
+        uint64_t blocked = now - t->sched.since;
+
+        t->sched.blocked_cycles += blocked;
+        block_cnt[t->sched.reason]++;
+        block_cycles[t->sched.reason] += blocked;
+        t->sched.blocked = false;
+    }
+    t->sched.since = now;
+    t->sched.woken = true;
+}
+
+/* Records a switch from CUR, which is no longer running, to
+   NEXT. */
+void schedstat_switch(struct thread *cur, struct thread *next)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (cur->status == THREAD_READY)
+    {
+        cur->sched.involuntary++;
+        involuntary_cnt++;
+    }
+    else
+    {
+        cur->sched.voluntary++;
+        voluntary_cnt++;
+    }
+
+    if (next->sched.woken)
+    {
+        uint64_t latency = rdtsc() - next->sched.since;
+        int bucket = 0;
+
+        while (bucket < LATENCY_BUCKETS - 1 && latency >= (uint64_t)1 << (LATENCY_SHIFT + bucket))
+            bucket++;
+        latency_hist[bucket]++;
+        if (latency > latency_max)
+            latency_max = latency;
+        next->sched.latency_cycles += latency;
+        next->sched.woken = false;
+    }
+}
+
+/* Samples the run queue length READY_CNT.  Called by the timer
+   interrupt handler at each timer tick. */
+void schedstat_tick(int ready_cnt)
+{
+    ready_samples++;
+    ready_sum += ready_cnt;
+    if (ready_cnt > ready_max)
+        ready_max = ready_cnt;
+}
+
+/* Records a priority donation that raised the priority of DEPTH
+   threads, following a chain of locks. */
+void schedstat_donation(int depth)
+{
+    donation_cnt++;
+    donation_depth_sum += depth;
+    if (depth > donation_depth_max)
+        donation_depth_max = depth;
+}
+
+/* Prints the scheduler statistics, global and for each thread
+   still alive. */
+void schedstat_print(void)
+{
+    enum intr_level old_level;
+    int i;
+
+    printf("Schedstat: %lld voluntary, %lld involuntary context switches\n",
+           voluntary_cnt, involuntary_cnt);
+    printf("Schedstat: run queue length %lld.%02lld on average, %d at most, "
+           "over %lld ticks\n",
+           ready_samples > 0 ? ready_sum / ready_samples : 0,
+           ready_samples > 0 ? ready_sum * 100 / ready_samples % 100 : 0,
+           ready_max, ready_samples);
+    printf("Schedstat: %lld donations, %lld threads raised, %d at most\n",
+           donation_cnt, donation_depth_sum, donation_depth_max);
+
+    printf("Schedstat: wakeup latency, at most %llu cycles:\n", latency_max);
+    for (i = 0; i < LATENCY_BUCKETS; i++)
+        if (latency_hist[i] > 0)
+            printf("Schedstat:   %s %7llu cycles: %lld\n",
+                   i < LATENCY_BUCKETS - 1 ? "<" : ">=",
+                   (uint64_t)1 << (LATENCY_SHIFT + (i < LATENCY_BUCKETS - 1 ? i : i - 1)),
+                   latency_hist[i]);
+
+    printf("Schedstat: blocked, by reason:\n");
+    for (i = 0; i < WAIT_REASON_CNT; i++)
+        if (block_cnt[i] > 0)
+            printf("Schedstat:   %-6s %lld times, %llu cycles on average\n",
+                   wait_reason_names[i], block_cnt[i],
+                   block_cycles[i] / block_cnt[i]);
+
+    old_level = intr_disable();
+    thread_foreach(print_thread, NULL);
+    intr_set_level(old_level);
+}
+
+/* Prints the statistics of thread T. */
+static void
+print_thread(struct thread *t, void *aux UNUSED)
+{
+    printf("Schedstat: thread %d \"%s\": %lld voluntary, %lld involuntary, "
+           "%llu cycles blocked, %llu cycles from wakeup to run\n",
+           t->tid, t->name, t->sched.voluntary, t->sched.involuntary,
+           t->sched.blocked_cycles, t->sched.latency_cycles);
+}
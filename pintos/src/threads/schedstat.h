@@ -0,0 +1,48 @@
+#ifndef THREADS_SCHEDSTAT_H
+#define THREADS_SCHEDSTAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct thread;
+
+/* What a blocked thread is waiting for. */
+enum wait_reason
+{
+    WAIT_OTHER,     /* Direct call to thread_block(). */
+    WAIT_SEMA,      /* Semaphore. */
+    WAIT_LOCK,      /* Lock. */
+    WAIT_COND,      /* Condition variable. */
+    WAIT_RWLOCK,    /* Reader-writer lock. */
+    WAIT_SLEEP,     /* timer_sleep(). */
+    WAIT_IO,        /* Interrupt queue. */
+    WAIT_PERIOD,    /* Periodic thread's next release. */
+    WAIT_REASON_CNT /* Number of reasons. */
+};
+
+/* Per-thread scheduler statistics.  Times are in time-stamp
+   counter cycles. */
+struct schedstat
+{
+    long long voluntary;     /* # of switches away while blocking. */
+    long long involuntary;   /* # of switches away while ready. */
+    uint64_t blocked_cycles; /* Total time blocked. */
+    uint64_t latency_cycles; /* Total time from wakeup to running. */
+    uint64_t since;          /* When last blocked or woken up. */
+    enum wait_reason reason; /* What it waits for while blocked. */
+    bool blocked;            /* Blocked since `since'? */
+    bool woken;              /* Woken up but not yet run? */
+};
+
+/* If true, collect scheduler statistics.  Controlled by kernel
+   command-line option "-o schedstat". */
+extern bool thread_schedstat;
+
+void schedstat_block(struct thread *, enum wait_reason);
+void schedstat_wakeup(struct thread *);
+void schedstat_switch(struct thread *cur, struct thread *next);
+void schedstat_tick(int ready_cnt);
+void schedstat_donation(int depth);
+void schedstat_print(void);
+
+#endif /* threads/schedstat.h */
@@ -29,10 +29,51 @@
 #include "threads/synch.h"
 #include <stdio.h>
 #include <string.h>
+#include "threads/cont.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/tsc.h"
+#include "devices/timer.h"
 
-static list_less_func less_sema_priority;
+/* A thread waiting on a semaphore until a deadline. */
+struct timed_wait
+{
+    struct semaphore *sema; /* Semaphore waited on. */
+    struct thread *thread;  /* Waiting thread. */
+    bool expired;           /* Deadline passed before wakeup? */
+};
+
+static timeout_func timed_wait_expired;
+static void sema_block(struct semaphore *);
+static void sema_wake(struct semaphore *, struct thread *);
+static heap_less_func less_waiter_priority;
+static heap_less_func less_cond_priority;
+static int waiters_priority(const struct lock *);
+static int donate_priority(struct hold *, struct thread *holder, int priority);
+static int pass_donation(struct thread *, int priority);
+static void revoke_priority(struct lock *);
+static void revoke_hold(struct hold *, struct thread *holder, int priority);
+static void revoke_donation(struct thread *);
+static void lock_set_holder(struct lock *, struct thread *);
+#ifdef LOCK_STAT
+static void count_wait(struct lock_class *, uint64_t wait, void *caller);
+static list_less_func more_wait;
+
+/* All lock classes that have been initialized.  Initialized
+   statically because locks are initialized early in boot. */
+static struct list lock_classes = LIST_INITIALIZER(lock_classes);
+#endif
+static void release_priority(struct thread *);
+static void donated(int depth);
+static int rwlock_waiters_priority(const struct rwlock *);
+static int rwlock_donate(struct rwlock *, int priority);
+static void rwlock_revoke(struct rwlock *);
+static void rwlock_wait(struct rwlock *, struct heap *waiters);
+static void rwlock_add_reader(struct rwlock *, struct thread *);
+static struct rwlock_reader *rwlock_find_reader(struct rwlock *, struct thread *);
+static void rwlock_stop_waiting(struct thread *);
+static void rwlock_grant(struct rwlock *);
+static void rwlock_update_holds(struct rwlock *);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -48,7 +89,8 @@ void sema_init(struct semaphore *sema, unsigned value)
     ASSERT(sema != NULL);
 
     sema->value = value;
-    list_init(&sema->waiters);
+    heap_init(&sema->waiters, less_waiter_priority, NULL);
+    list_init(&sema->conts);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -67,12 +109,154 @@ void sema_down(struct semaphore *sema)
 
     old_level = intr_disable();
     while (sema->value == 0)
+        sema_block(sema);
+    sema->value--;
+    intr_set_level(old_level);
+}
+
+/* Like sema_down(), but gives up once TICKS timer ticks have
+   passed without SEMA's value becoming positive.  Returns true
+   if SEMA was decremented, false if the wait timed out.  If
+   TICKS is zero or negative, does not wait at all.
+
+   The deadline is a timeout on the timer wheel, which is
+   cancelled in constant time if SEMA is upped first.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool sema_down_timeout(struct semaphore *sema, int64_t ticks)
+{
+    struct timed_wait wait;
+    struct timeout timeout;
+    enum intr_level old_level;
+    bool success;
+
+    ASSERT(sema != NULL);
+    ASSERT(!intr_context());
+
+    old_level = intr_disable();
+    if (sema->value == 0 && ticks > 0)
     {
-        list_push_back(&sema->waiters, &thread_current()->elem);
-        thread_block();
+        wait.sema = sema;
+        wait.thread = thread_current();
+        wait.expired = false;
+        timeout_init(&timeout, timed_wait_expired, &wait);
+        timeout_arm(&timeout, timer_ticks() + ticks);
+        while (sema->value == 0 && !wait.expired)
+            sema_block(sema);
+        timeout_cancel(&timeout);
     }
-    sema->value--;
+
+    success = sema->value > 0;
+    if (success)
+        sema->value--;
     intr_set_level(old_level);
+
+    return success;
+}
+
+/* Like sema_down(), but gives up once sema_cancel() is called
+   for the running thread, either before or during the wait.
+   Returns true if SEMA was decremented, false if the wait was
+   canceled.  Cancellation is permanent: every later cancelable
+   wait by the same thread fails at once.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool sema_down_cancelable(struct semaphore *sema)
+{
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+    bool success;
+
+    ASSERT(sema != NULL);
+    ASSERT(!intr_context());
+
+    old_level = intr_disable();
+    cur->cancel_sema = sema;
+    while (sema->value == 0 && !cur->canceled)
+        sema_block(sema);
+    cur->cancel_sema = NULL;
+
+    success = sema->value > 0;
+    if (success)
+        sema->value--;
+    intr_set_level(old_level);
+
+    return success;
+}
+
+/* Cancels thread T's cancelable waits: wakes T if it is blocked
+   in sema_down_cancelable(), and makes its later ones fail at
+   once.  Waits in plain sema_down() are not affected.
+
+   This function may be called from an interrupt handler. */
+void sema_cancel(struct thread *t)
+{
+    enum intr_level old_level;
+
+    ASSERT(t != NULL);
+
+    old_level = intr_disable();
+    t->canceled = true;
+    if (t->cancel_sema != NULL && t->status == THREAD_BLOCKED)
+        sema_wake(t->cancel_sema, t);
+    intr_set_level(old_level);
+}
+
+/* Adds the running thread to SEMA's waiters and blocks it until
+   sema_up(), an expired timed wait, or sema_cancel() wakes it.
+   Must be called with interrupts turned off. */
+static void
+sema_block(struct semaphore *sema)
+{
+    struct thread *cur = thread_current();
+    enum wait_reason reason;
+
+    /* A thread waiting for a lock has set wait_lock, and one
+       waiting on a condition variable is already registered in
+       the condition's waiters heap. */
+    if (cur->wait_lock != NULL)
+        reason = WAIT_LOCK;
+    else if (cur->wait_queue != NULL)
+        reason = WAIT_COND;
+    else
+        reason = WAIT_SEMA;
+
+    heap_push(&sema->waiters, &cur->waitelem);
+    if (cur->wait_queue == NULL)
+        thread_set_wait_queue(cur, &sema->waiters, &cur->waitelem);
+    thread_block_for(reason);
+}
+
+/* Timeout function for sema_down_timeout().  If the waiting
+   thread is still blocked on the semaphore, takes it out of the
+   semaphore's waiters and wakes it up.  Otherwise sema_up() has
+   already woken it and it will find the semaphore upped. */
+static void
+timed_wait_expired(void *wait_)
+{
+    struct timed_wait *wait = wait_;
+    struct thread *t = wait->thread;
+
+    wait->expired = true;
+    if (t->status == THREAD_BLOCKED)
+        sema_wake(wait->sema, t);
+}
+
+/* Takes thread T, which is blocked on SEMA, out of SEMA's
+   waiters and wakes it up without upping SEMA.  Must be called
+   with interrupts turned off. */
+static void
+sema_wake(struct semaphore *sema, struct thread *t)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(t->status == THREAD_BLOCKED);
+
+    heap_remove(&sema->waiters, &t->waitelem);
+    if (t->wait_queue == &sema->waiters)
+        thread_set_wait_queue(t, NULL, NULL);
+    thread_unblock(t);
 }
 
 /* Down or "P" operation on a semaphore, but only if the
@@ -100,9 +284,35 @@ bool sema_try_down(struct semaphore *sema)
     return success;
 }
 
+/* Down operation on a semaphore that does not wait: if SEMA's
+   value is positive, decrements it and schedules continuation
+   C, and otherwise queues C to be scheduled by a later
+   sema_up() instead of decrementing the value.
+
+   This function may be called from an interrupt handler. */
+void sema_down_async(struct semaphore *sema, struct cont *c)
+{
+    enum intr_level old_level;
+
+    ASSERT(sema != NULL);
+    ASSERT(c != NULL);
+
+    old_level = intr_disable();
+    if (sema->value > 0)
+    {
+        sema->value--;
+        cont_schedule(c);
+    }
+    else
+        list_push_back(&sema->conts, &c->elem);
+    intr_set_level(old_level);
+}
+
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
    and wakes up one thread with the highest priority among
-   waiters for SEMA, if any.
+   waiters for SEMA, if any.  If no thread is waiting, hands the
+   increment to the first continuation queued by
+   sema_down_async(), if any, and schedules it.
 
    This function may be called from an interrupt handler. */
 void sema_up(struct semaphore *sema)
@@ -112,14 +322,21 @@ void sema_up(struct semaphore *sema)
     ASSERT(sema != NULL);
 
     old_level = intr_disable();
+    if (heap_empty(&sema->waiters) && !list_empty(&sema->conts))
+    {
+        cont_schedule(list_entry(list_pop_front(&sema->conts),
+                                 struct cont, elem));
+        intr_set_level(old_level);
+        return;
+    }
     sema->value++;
-    if (!list_empty(&sema->waiters))
+    if (!heap_empty(&sema->waiters))
     {
-        struct list_elem *max_e = list_max(&sema->waiters, less_priority, NULL);
-        struct thread *max_t = list_entry(max_e, struct thread, elem);
+        struct thread *t = heap_entry(heap_pop(&sema->waiters), struct thread, waitelem);
 
-        list_remove(max_e);
-        thread_unblock(max_t);
+        if (t->wait_queue == &sema->waiters)
+            thread_set_wait_queue(t, NULL, NULL);
+        thread_unblock(t);
     }
     intr_set_level(old_level);
 }
@@ -174,20 +391,42 @@ sema_test_helper(void *sema_)
    another one "up" it, but with a lock the same thread must both
    acquire and release it.  When these restrictions prove
    onerous, it's a good sign that a semaphore should be used,
-   instead of a lock. */
+   instead of a lock.
+
+   With LOCK_STAT, lock_init() is a macro that calls this with a
+   class of its own for each call site, which keeps LOCK's
+   statistics. */
+#ifdef LOCK_STAT
+void lock_init_class(struct lock *lock, struct lock_class *class)
+#else
 void lock_init(struct lock *lock)
+#endif
 {
     ASSERT(lock != NULL);
 
     lock->holder = NULL;
     sema_init(&lock->semaphore, 1);
+    lock->hold.priority = PRI_MIN;
+#ifdef LOCK_STAT
+    {
+        enum intr_level old_level = intr_disable();
+
+        lock->class = class;
+        if (!class->registered)
+        {
+            class->registered = true;
+            list_push_back(&lock_classes, &class->elem);
+        }
+        intr_set_level(old_level);
+    }
+#endif
 }
 
-/* If the holder of LOCK has lower priority than the current
-   thread, it, its donee, its donee's donee, and so on should
-   be donated priority. Then, acquire LOCK, sleeping until it
-   becomes available if necessary. The lock must not already
-   be held by the current thread.
+/* Acquires LOCK, sleeping until it becomes available if
+   necessary.  The lock must not already be held by the current
+   thread.  While waiting, the current thread donates its
+   priority to the holder of LOCK, and through it, to whatever
+   the holder is waiting for.
 
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
@@ -195,26 +434,82 @@ void lock_init(struct lock *lock)
    we need to sleep. */
 void lock_acquire(struct lock *lock)
 {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+#ifdef LOCK_STAT
+    bool contended;
+    uint64_t start;
+#endif
+
     ASSERT(lock != NULL);
     ASSERT(!intr_context());
     ASSERT(!lock_held_by_current_thread(lock));
 
+    old_level = intr_disable();
+#ifdef LOCK_STAT
+    contended = lock->semaphore.value == 0;
+    start = rdtsc();
+#endif
+    cur->wait_lock = lock;
+    if (!thread_mlfqs && !thread_cfs && lock->holder != NULL)
+        donated(donate_priority(&lock->hold, lock->holder, cur->priority));
+
+    sema_down(&lock->semaphore);
+
+    cur->wait_lock = NULL;
+    lock_set_holder(lock, cur);
+#ifdef LOCK_STAT
+    if (contended)
+        count_wait(lock->class, rdtsc() - start, __builtin_return_address(0));
+#endif
+    intr_set_level(old_level);
+}
+
+/* Like lock_acquire(), but gives up once TICKS timer ticks have
+   passed without acquiring LOCK.  Returns true if LOCK was
+   acquired, false if the wait timed out.  On timeout, the
+   priority donated while waiting is taken back from the holder
+   and from whatever the holder is waiting for.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool lock_acquire_timeout(struct lock *lock, int64_t ticks)
+{
     struct thread *cur = thread_current();
+    enum intr_level old_level;
+    bool success;
+#ifdef LOCK_STAT
+    bool contended;
+    uint64_t start;
+#endif
 
-    if (!thread_mlfqs && lock->holder != NULL && lock->holder->priority < cur->priority)
-    {
-        struct thread *donee = lock->holder;
-        while (donee != NULL)
-        {
-            donee->priority = cur->priority;
-            donee = donee->donee;
-        }
-        thread_set_donee(lock->holder);
-        list_push_back(&lock->holder->donators, &cur->doelem);
-    }
+    ASSERT(lock != NULL);
+    ASSERT(!intr_context());
+    ASSERT(!lock_held_by_current_thread(lock));
 
-    sema_down(&lock->semaphore);
-    lock->holder = cur;
+    old_level = intr_disable();
+#ifdef LOCK_STAT
+    contended = lock->semaphore.value == 0 && ticks > 0;
+    start = rdtsc();
+#endif
+    cur->wait_lock = lock;
+    if (!thread_mlfqs && !thread_cfs && lock->holder != NULL && ticks > 0)
+        donated(donate_priority(&lock->hold, lock->holder, cur->priority));
+
+    success = sema_down_timeout(&lock->semaphore, ticks);
+
+    cur->wait_lock = NULL;
+    if (success)
+        lock_set_holder(lock, cur);
+    else if (!thread_mlfqs && !thread_cfs)
+        revoke_priority(lock);
+#ifdef LOCK_STAT
+    if (contended)
+        count_wait(lock->class, rdtsc() - start, __builtin_return_address(0));
+#endif
+    intr_set_level(old_level);
+
+    return success;
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -225,51 +520,53 @@ void lock_acquire(struct lock *lock)
    interrupt handler. */
 bool lock_try_acquire(struct lock *lock)
 {
+    enum intr_level old_level;
     bool success;
 
     ASSERT(lock != NULL);
     ASSERT(!lock_held_by_current_thread(lock));
 
+    old_level = intr_disable();
     success = sema_try_down(&lock->semaphore);
     if (success)
-        lock->holder = thread_current();
+        lock_set_holder(lock, thread_current());
+    intr_set_level(old_level);
     return success;
 }
 
-/* Delete all donators of the current thread, which are waiting
-   for LOCK. Then, release LOCK, which must be owned by the
-   current thread. Lastly, delete its donee and set its priority
-   properly.
+/* Releases LOCK, which must be owned by the current thread, and
+   gives up the priority donated through it.  The threads still
+   waiting for LOCK donate to its next holder instead.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
    handler. */
 void lock_release(struct lock *lock)
 {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+
     ASSERT(lock != NULL);
     ASSERT(lock_held_by_current_thread(lock));
 
-    struct list *waiters = &lock->semaphore.waiters,
-                *donators = thread_get_donators();
-    struct list_elem *e, *de;
-
-    if (!thread_mlfqs)
-        for (e = list_begin(waiters); e != list_end(waiters); e = list_next(e))
-            for (de = list_begin(donators); de != list_end(donators); de = list_next(de))
-                if (&list_entry(e, struct thread, elem)->doelem == de)
-                {
-                    list_remove(de);
-                    break;
-                }
+    old_level = intr_disable();
+#ifdef LOCK_STAT
+    {
+        uint64_t hold = rdtsc() - lock->acquired;
 
+        lock->class->hold_sum += hold;
+        if (hold > lock->class->hold_max)
+            lock->class->hold_max = hold;
+    }
+#endif
+    heap_remove(&cur->held_locks, &lock->hold.elem);
     lock->holder = NULL;
+    release_priority(cur);
     sema_up(&lock->semaphore);
+    intr_set_level(old_level);
 
-    if (!thread_mlfqs)
-    {
-        thread_set_donee(NULL);
-        thread_set_priority(thread_get_priority());
-    }
+    if (!thread_mlfqs && !thread_cfs)
+        thread_set_priority(cur->original_priority);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -282,12 +579,101 @@ bool lock_held_by_current_thread(const struct lock *lock)
     return lock->holder == thread_current();
 }
 
-/* One semaphore in a list. */
+#ifdef LOCK_STAT
+/* Prints the statistics of each lock class that has had to
+   wait, by total wait, longest first.  May be called at any
+   time to see the contention so far. */
+void lock_print_stats(void)
+{
+    enum intr_level old_level;
+    struct list_elem *e;
+    int quiet_cnt = 0;
+
+    old_level = intr_disable();
+    list_sort(&lock_classes, more_wait, NULL);
+    intr_set_level(old_level);
+
+    printf("Lock contention, by total wait in TSC cycles:\n");
+    for (e = list_begin(&lock_classes); e != list_end(&lock_classes);
+         e = list_next(e))
+    {
+        struct lock_class *c = list_entry(e, struct lock_class, elem);
+        int i;
+
+        if (c->contended_cnt == 0)
+        {
+            quiet_cnt++;
+            continue;
+        }
+        printf("  %s (%s:%d): %lld acquired, %lld contended, "
+               "wait %llu total/%llu max, hold %llu total/%llu max\n",
+               c->name, c->file, c->line, c->acquire_cnt, c->contended_cnt,
+               (unsigned long long)c->wait_sum,
+               (unsigned long long)c->wait_max,
+               (unsigned long long)c->hold_sum,
+               (unsigned long long)c->hold_max);
+        for (i = 0; i < LOCK_STAT_WAITERS && c->waiters[i].caller != NULL; i++)
+            printf("    waiter %p: %lld waits, %llu total\n",
+                   c->waiters[i].caller, c->waiters[i].wait_cnt,
+                   (unsigned long long)c->waiters[i].wait_sum);
+    }
+    printf("  %d lock classes never contended.\n", quiet_cnt);
+}
+
+/* Adds a wait of WAIT cycles by CALLER to CLASS.  CALLER
+   replaces the top waiter that has waited the least if CLASS has
+   no room for it and WAIT alone is longer.  Must be called with
+   interrupts turned off. */
+static void
+count_wait(struct lock_class *class, uint64_t wait, void *caller)
+{
+    struct lock_waiter *w, *min = NULL;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    class->contended_cnt++;
+    class->wait_sum += wait;
+    if (wait > class->wait_max)
+        class->wait_max = wait;
+
+    for (w = class->waiters; w < class->waiters + LOCK_STAT_WAITERS; w++)
+    {
+        if (w->caller == caller || w->caller == NULL)
+            break;
+        if (min == NULL || w->wait_sum < min->wait_sum)
+            min = w;
+    }
+    if (w == class->waiters + LOCK_STAT_WAITERS)
+    {
+        if (wait <= min->wait_sum)
+            return;
+        w = min;
+        w->wait_cnt = 0;
+        w->wait_sum = 0;
+    }
+    w->caller = caller;
+    w->wait_cnt++;
+    w->wait_sum += wait;
+}
+
+/* Returns true if lock class A has waited longer than B. */
+static bool
+more_wait(const struct list_elem *a_, const struct list_elem *b_,
+          void *aux UNUSED)
+{
+    const struct lock_class *a = list_entry(a_, struct lock_class, elem);
+    const struct lock_class *b = list_entry(b_, struct lock_class, elem);
+
+    return a->wait_sum > b->wait_sum;
+}
+#endif
+
+/* One semaphore in a condition variable's waiters heap. */
 struct semaphore_elem
 {
-    struct list_elem elem;      /* List element. */
+    struct heap_elem elem;      /* Heap element. */
     struct semaphore semaphore; /* This semaphore. */
-    int priority;               /* Priority. */
+    struct thread *thread;      /* Waiting thread. */
 };
 
 /* Initializes condition variable COND.  A condition variable
@@ -297,7 +683,7 @@ void cond_init(struct condition *cond)
 {
     ASSERT(cond != NULL);
 
-    list_init(&cond->waiters);
+    heap_init(&cond->waiters, less_cond_priority, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -323,20 +709,69 @@ void cond_init(struct condition *cond)
 void cond_wait(struct condition *cond, struct lock *lock)
 {
     struct semaphore_elem waiter;
+    enum intr_level old_level;
 
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
     ASSERT(!intr_context());
     ASSERT(lock_held_by_current_thread(lock));
 
+    /* The thread waits in COND's heap, not in WAITER's private
+       semaphore, so that is where a priority change re-keys it. */
     sema_init(&waiter.semaphore, 0);
-    waiter.priority = thread_get_priority();
-    list_push_back(&cond->waiters, &waiter.elem);
+    waiter.thread = thread_current();
+    old_level = intr_disable();
+    heap_push(&cond->waiters, &waiter.elem);
+    thread_set_wait_queue(waiter.thread, &cond->waiters, &waiter.elem);
+    intr_set_level(old_level);
     lock_release(lock);
     sema_down(&waiter.semaphore);
     lock_acquire(lock);
 }
 
+/* Like cond_wait(), but stops waiting once TICKS timer ticks
+   have passed without COND being signaled.  Returns true if COND
+   was signaled, false if the wait timed out.  Either way, LOCK is
+   reacquired before returning.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool cond_wait_timeout(struct condition *cond, struct lock *lock, int64_t ticks)
+{
+    struct semaphore_elem waiter;
+    enum intr_level old_level;
+    bool signaled;
+
+    ASSERT(cond != NULL);
+    ASSERT(lock != NULL);
+    ASSERT(!intr_context());
+    ASSERT(lock_held_by_current_thread(lock));
+
+    sema_init(&waiter.semaphore, 0);
+    waiter.thread = thread_current();
+    old_level = intr_disable();
+    heap_push(&cond->waiters, &waiter.elem);
+    thread_set_wait_queue(waiter.thread, &cond->waiters, &waiter.elem);
+    intr_set_level(old_level);
+    lock_release(lock);
+
+    /* cond_signal() takes WAITER out of COND's heap before it ups
+       WAITER's semaphore, so WAITER being still in the heap after
+       the wait means that no signal arrived. */
+    old_level = intr_disable();
+    sema_down_timeout(&waiter.semaphore, ticks);
+    signaled = waiter.thread->wait_queue != &cond->waiters;
+    if (!signaled)
+    {
+        heap_remove(&cond->waiters, &waiter.elem);
+        thread_set_wait_queue(waiter.thread, NULL, NULL);
+    }
+    intr_set_level(old_level);
+
+    lock_acquire(lock);
+    return signaled;
+}
+
 /* If any threads are waiting on COND (protected by LOCK), then
    this function signals one of them to wake up from its wait.
    LOCK must be held before calling this function.
@@ -351,13 +786,14 @@ void cond_signal(struct condition *cond, struct lock *lock UNUSED)
     ASSERT(!intr_context());
     ASSERT(lock_held_by_current_thread(lock));
 
-    if (!list_empty(&cond->waiters))
+    if (!heap_empty(&cond->waiters))
     {
-        struct list_elem *e = list_max(&cond->waiters, less_sema_priority, NULL);
-        struct semaphore_elem *se = list_entry(e, struct semaphore_elem, elem);
+        enum intr_level old_level = intr_disable();
+        struct semaphore_elem *se = heap_entry(heap_pop(&cond->waiters), struct semaphore_elem, elem);
 
-        list_remove(e);
+        thread_set_wait_queue(se->thread, NULL, NULL);
         sema_up(&se->semaphore);
+        intr_set_level(old_level);
     }
 }
 
@@ -372,17 +808,592 @@ void cond_broadcast(struct condition *cond, struct lock *lock)
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
 
-    while (!list_empty(&cond->waiters))
+    while (!heap_empty(&cond->waiters))
         cond_signal(cond, lock);
 }
 
-/* Compares priority of two list elements A and B.
-   Returns true if A is less than B, or false if A is
+/* Initializes RWLOCK.  A reader-writer lock can be held for
+   reading by any number of threads at once, or for writing by a
+   single thread, so that read-mostly data need not serialize its
+   readers.
+
+   Writers are preferred: a thread that asks to read waits while
+   any thread waits to write, so that a steady stream of readers
+   cannot starve writers.  When a writer releases the lock, it
+   passes to the highest-priority writer waiting, unless the
+   readers waiting have a higher priority, in which case it
+   passes to all of them.
+
+   The threads waiting for a reader-writer lock donate their
+   priority to the writer or to every reader holding it.
+
+   A thread may hold at most RWLOCK_READS_MAX reader-writer locks
+   for reading at a time, and must not acquire a lock for reading
+   that it already holds. */
+void rwlock_init(struct rwlock *rwlock)
+{
+    ASSERT(rwlock != NULL);
+
+    list_init(&rwlock->readers);
+    rwlock->reader_cnt = 0;
+    rwlock->writer = NULL;
+    rwlock->write_hold.priority = PRI_MIN;
+    rwlock->upgrader = NULL;
+    heap_init(&rwlock->read_waiters, less_waiter_priority, NULL);
+    heap_init(&rwlock->write_waiters, less_waiter_priority, NULL);
+}
+
+/* Acquires RWLOCK for reading, sleeping until no thread holds it
+   for writing, waits to write, or waits to upgrade.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rwlock_acquire_read(struct rwlock *rwlock)
+{
+    enum intr_level old_level;
+
+    ASSERT(rwlock != NULL);
+    ASSERT(!intr_context());
+    ASSERT(!rwlock_held_by_current_thread(rwlock));
+
+    old_level = intr_disable();
+    if (rwlock->writer != NULL || rwlock->upgrader != NULL || !heap_empty(&rwlock->write_waiters))
+        rwlock_wait(rwlock, &rwlock->read_waiters);
+    else
+        rwlock_add_reader(rwlock, thread_current());
+    intr_set_level(old_level);
+}
+
+/* Releases RWLOCK, which must be held for reading by the current
+   thread.  The last reader to leave passes the lock to a waiting
+   upgrader or writer. */
+void rwlock_release_read(struct rwlock *rwlock)
+{
+    struct thread *cur = thread_current();
+    struct rwlock_reader *r;
+    enum intr_level old_level;
+
+    ASSERT(rwlock != NULL);
+
+    old_level = intr_disable();
+    r = rwlock_find_reader(rwlock, cur);
+    ASSERT(r != NULL);
+    list_remove(&r->elem);
+    heap_remove(&cur->held_locks, &r->hold.elem);
+    r->rwlock = NULL;
+    rwlock->reader_cnt--;
+    release_priority(cur);
+    rwlock_grant(rwlock);
+    intr_set_level(old_level);
+
+    if (!thread_mlfqs && !thread_cfs)
+        thread_set_priority(cur->original_priority);
+}
+
+/* Acquires RWLOCK for writing, sleeping until no other thread
+   holds it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rwlock_acquire_write(struct rwlock *rwlock)
+{
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+
+    ASSERT(rwlock != NULL);
+    ASSERT(!intr_context());
+    ASSERT(!rwlock_held_by_current_thread(rwlock));
+
+    old_level = intr_disable();
+    if (rwlock->writer != NULL || rwlock->reader_cnt > 0 || rwlock->upgrader != NULL)
+        rwlock_wait(rwlock, &rwlock->write_waiters);
+    else
+    {
+        rwlock->writer = cur;
+        rwlock->write_hold.priority = PRI_MIN;
+        heap_push(&cur->held_locks, &rwlock->write_hold.elem);
+    }
+    intr_set_level(old_level);
+}
+
+/* Releases RWLOCK, which must be held for writing by the current
+   thread, and passes it to the threads waiting for it. */
+void rwlock_release_write(struct rwlock *rwlock)
+{
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+
+    ASSERT(rwlock != NULL);
+    ASSERT(rwlock->writer == cur);
+
+    old_level = intr_disable();
+    heap_remove(&cur->held_locks, &rwlock->write_hold.elem);
+    rwlock->writer = NULL;
+    release_priority(cur);
+    rwlock_grant(rwlock);
+    intr_set_level(old_level);
+
+    if (!thread_mlfqs && !thread_cfs)
+        thread_set_priority(cur->original_priority);
+}
+
+/* Converts the current thread's hold on RWLOCK from reading to
+   writing, sleeping until the other readers have left.  Threads
+   waiting to write do not get in first.  Returns true if
+   successful, or false without sleeping if another reader is
+   already waiting to upgrade, because the two would otherwise
+   wait for each other forever.  In that case the caller still
+   holds RWLOCK for reading and should release it.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool rwlock_upgrade(struct rwlock *rwlock)
+{
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+
+    ASSERT(rwlock != NULL);
+    ASSERT(!intr_context());
+
+    old_level = intr_disable();
+    ASSERT(rwlock_find_reader(rwlock, cur) != NULL);
+    if (rwlock->upgrader != NULL)
+    {
+        intr_set_level(old_level);
+        return false;
+    }
+    rwlock->upgrader = cur;
+    if (rwlock->reader_cnt > 1)
+    {
+        cur->wait_rwlock = rwlock;
+        if (!thread_mlfqs && !thread_cfs)
+            donated(rwlock_donate(rwlock, cur->priority));
+        thread_block_for(WAIT_RWLOCK);
+    }
+    else
+        rwlock_grant(rwlock);
+    intr_set_level(old_level);
+    return true;
+}
+
+/* Returns true if the current thread holds RWLOCK for reading or
+   writing, false otherwise. */
+bool rwlock_held_by_current_thread(const struct rwlock *rwlock)
+{
+    struct thread *cur = thread_current();
+    int i;
+
+    ASSERT(rwlock != NULL);
+
+    if (rwlock->writer == cur)
+        return true;
+    for (i = 0; i < RWLOCK_READS_MAX; i++)
+        if (cur->reads[i].rwlock == rwlock)
+            return true;
+    return false;
+}
+
+/* Compares the priorities of two threads A and B waiting on a
+   semaphore.  Returns true if A is less than B, or false if A is
    greater than or equal to B. */
 static bool
-less_sema_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
+less_waiter_priority(const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED)
+{
+    const struct thread *a_t = heap_entry(a, struct thread, waitelem);
+    const struct thread *b_t = heap_entry(b, struct thread, waitelem);
+    return a_t->priority < b_t->priority;
+}
+
+/* Compares the priorities of the threads waiting in two
+   semaphore_elems A and B.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+static bool
+less_cond_priority(const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED)
+{
+    const struct semaphore_elem *a_s = heap_entry(a, struct semaphore_elem, elem);
+    const struct semaphore_elem *b_s = heap_entry(b, struct semaphore_elem, elem);
+    return a_s->thread->priority < b_s->thread->priority;
+}
+
+/* Returns the highest priority among the threads waiting for
+   LOCK, or PRI_MIN if there are none. */
+static int
+waiters_priority(const struct lock *lock)
+{
+    const struct heap *waiters = &lock->semaphore.waiters;
+
+    if (heap_empty(waiters))
+        return PRI_MIN;
+    return heap_entry(heap_top(waiters), struct thread, waitelem)->priority;
+}
+
+/* Makes running thread T the holder of LOCK, which it just
+   acquired.  T receives the priority of the threads still
+   waiting for LOCK.  Must be called with interrupts turned
+   off. */
+static void
+lock_set_holder(struct lock *lock, struct thread *t)
 {
-    const struct semaphore_elem *a_s = list_entry(a, struct semaphore_elem, elem);
-    const struct semaphore_elem *b_s = list_entry(b, struct semaphore_elem, elem);
-    return a_s->priority < b_s->priority;
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    lock->holder = t;
+    lock->hold.priority = waiters_priority(lock);
+#ifdef LOCK_STAT
+    lock->acquired = rdtsc();
+    lock->class->acquire_cnt++;
+#endif
+    heap_push(&t->held_locks, &lock->hold.elem);
+    if (!thread_mlfqs && !thread_cfs)
+        thread_change_priority(t, thread_effective_priority(t));
+}
+
+/* Drops the priority donated to running thread CUR through a
+   hold it just gave up, before the waiters are woken up, so that
+   a waiter that now preempts CUR is handed the CPU directly.
+   Must be called with interrupts turned off. */
+static void
+release_priority(struct thread *cur)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (!thread_mlfqs && !thread_cfs)
+        thread_change_priority(cur, thread_effective_priority(cur));
+}
+
+/* Donates PRIORITY to HOLDER through HOLD, its hold on a lock
+   that a thread with that priority is about to wait for.  Raises
+   the priority donated through HOLD, then HOLDER's priority, and
+   then passes the donation on to the holders of whatever HOLDER
+   is waiting for, and so on, until some priority is already high
+   enough.  Each step takes O(log n) time.  Returns the number of
+   threads whose priority was raised along the longest chain.
+
+   A waiting thread's priority can only rise while it waits, so
+   donated priorities only need to be raised here.  They are
+   recomputed from scratch when a lock changes hands.
+
+   Must be called with interrupts turned off. */
+static int
+donate_priority(struct hold *hold, struct thread *holder, int priority)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (hold->priority >= priority)
+        return 0;
+    hold->priority = priority;
+    heap_update(&holder->held_locks, &hold->elem);
+    if (holder->priority >= priority)
+        return 0;
+    thread_change_priority(holder, priority);
+    return 1 + pass_donation(holder, priority);
+}
+
+/* Records in the scheduler statistics that the running thread
+   just raised the priority of DEPTH threads by donation. */
+static void
+donated(int depth)
+{
+    if (thread_schedstat)
+        schedstat_donation(depth);
+}
+
+/* Passes PRIORITY, just donated to waiting thread T, on to the
+   holder or holders of the lock or reader-writer lock that T is
+   waiting for.  Returns the number of threads whose priority
+   was raised along the longest chain. */
+static int
+pass_donation(struct thread *t, int priority)
+{
+    if (t->wait_lock != NULL && t->wait_lock->holder != NULL)
+        return donate_priority(&t->wait_lock->hold, t->wait_lock->holder, priority);
+    else if (t->wait_rwlock != NULL)
+        return rwlock_donate(t->wait_rwlock, priority);
+    return 0;
+}
+
+/* Recomputes the priority LOCK donates after a thread stopped
+   waiting for it without acquiring it, and lowers the holder's
+   priority, and the priority donated through whatever the holder
+   is waiting for, and so on, as far as they drop.
+
+   Must be called with interrupts turned off. */
+static void
+revoke_priority(struct lock *lock)
+{
+    int priority = waiters_priority(lock);
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (lock->holder != NULL)
+        revoke_hold(&lock->hold, lock->holder, priority);
+    else if (priority < lock->hold.priority)
+        lock->hold.priority = priority;
+}
+
+/* Lowers the priority donated to HOLDER through HOLD to
+   PRIORITY, if it is higher, then HOLDER's priority, and passes
+   the drop on through whatever HOLDER is waiting for.  The
+   reverse of donate_priority().  Must be called with interrupts
+   turned off. */
+static void
+revoke_hold(struct hold *hold, struct thread *holder, int priority)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (priority >= hold->priority)
+        return;
+    hold->priority = priority;
+    heap_update(&holder->held_locks, &hold->elem);
+    priority = thread_effective_priority(holder);
+    if (priority >= holder->priority)
+        return;
+    thread_change_priority(holder, priority);
+    revoke_donation(holder);
+}
+
+/* Recomputes what waiting thread T donates to the holder or
+   holders of the lock or reader-writer lock it is waiting for,
+   after T's priority dropped.  The reverse of
+   pass_donation(). */
+static void
+revoke_donation(struct thread *t)
+{
+    if (t->wait_lock != NULL)
+        revoke_priority(t->wait_lock);
+    else if (t->wait_rwlock != NULL)
+        rwlock_revoke(t->wait_rwlock);
+}
+
+/* Returns the highest priority among the threads waiting for
+   RWLOCK, or PRI_MIN if there are none. */
+static int
+rwlock_waiters_priority(const struct rwlock *rwlock)
+{
+    int priority = PRI_MIN;
+
+    if (!heap_empty(&rwlock->read_waiters))
+        priority = heap_entry(heap_top(&rwlock->read_waiters), struct thread, waitelem)->priority;
+    if (!heap_empty(&rwlock->write_waiters))
+    {
+        int p = heap_entry(heap_top(&rwlock->write_waiters), struct thread, waitelem)->priority;
+        if (p > priority)
+            priority = p;
+    }
+    if (rwlock->upgrader != NULL && rwlock->upgrader->priority > priority)
+        priority = rwlock->upgrader->priority;
+    return priority;
+}
+
+/* Donates PRIORITY to the writer or to every reader holding
+   RWLOCK, which a thread with that priority is waiting for.
+   Returns the number of threads whose priority was raised along
+   the longest chain.  Must be called with interrupts turned
+   off. */
+static int
+rwlock_donate(struct rwlock *rwlock, int priority)
+{
+    struct list_elem *e;
+    int depth = 0;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (rwlock->writer != NULL)
+        depth = donate_priority(&rwlock->write_hold, rwlock->writer, priority);
+    for (e = list_begin(&rwlock->readers); e != list_end(&rwlock->readers); e = list_next(e))
+    {
+        struct rwlock_reader *r = list_entry(e, struct rwlock_reader, elem);
+        int d = donate_priority(&r->hold, r->thread, priority);
+
+        if (d > depth)
+            depth = d;
+    }
+    return depth;
+}
+
+/* Recomputes the priority RWLOCK donates after the priority of
+   a thread waiting for it dropped, and lowers the priority
+   donated to the writer or to each reader holding it
+   accordingly.  The reverse of rwlock_donate().  Must be called
+   with interrupts turned off. */
+static void
+rwlock_revoke(struct rwlock *rwlock)
+{
+    int priority = rwlock_waiters_priority(rwlock);
+    struct list_elem *e;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (rwlock->writer != NULL)
+        revoke_hold(&rwlock->write_hold, rwlock->writer, priority);
+    for (e = list_begin(&rwlock->readers); e != list_end(&rwlock->readers); e = list_next(e))
+    {
+        struct rwlock_reader *r = list_entry(e, struct rwlock_reader, elem);
+
+        revoke_hold(&r->hold, r->thread, priority);
+    }
+}
+
+/* Puts the current thread to sleep in WAITERS, one of RWLOCK's
+   waiters heaps, until rwlock_grant() passes RWLOCK to it.  Must
+   be called with interrupts turned off. */
+static void
+rwlock_wait(struct rwlock *rwlock, struct heap *waiters)
+{
+    struct thread *cur = thread_current();
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    heap_push(waiters, &cur->waitelem);
+    thread_set_wait_queue(cur, waiters, &cur->waitelem);
+    cur->wait_rwlock = rwlock;
+    if (!thread_mlfqs && !thread_cfs)
+        donated(rwlock_donate(rwlock, cur->priority));
+    thread_block_for(WAIT_RWLOCK);
+}
+
+/* Makes T, which is running or has just been woken up, a reader
+   of RWLOCK.  Must be called with interrupts turned off. */
+static void
+rwlock_add_reader(struct rwlock *rwlock, struct thread *t)
+{
+    struct rwlock_reader *r = rwlock_find_reader(NULL, t);
+
+    ASSERT(intr_get_level() == INTR_OFF);
+    if (r == NULL)
+        PANIC("%s holds too many reader-writer locks for reading", t->name);
+
+    r->rwlock = rwlock;
+    r->thread = t;
+    r->hold.priority = PRI_MIN;
+    heap_push(&t->held_locks, &r->hold.elem);
+    list_push_back(&rwlock->readers, &r->elem);
+    rwlock->reader_cnt++;
+}
+
+/* Returns T's read hold on RWLOCK, or a free read hold slot if
+   RWLOCK is null, or a null pointer if there is none. */
+static struct rwlock_reader *
+rwlock_find_reader(struct rwlock *rwlock, struct thread *t)
+{
+    int i;
+
+    for (i = 0; i < RWLOCK_READS_MAX; i++)
+        if (t->reads[i].rwlock == rwlock)
+            return &t->reads[i];
+    return NULL;
+}
+
+/* Records that T, just taken out of a reader-writer lock's
+   waiters heap, no longer waits for the lock. */
+static void
+rwlock_stop_waiting(struct thread *t)
+{
+    thread_set_wait_queue(t, NULL, NULL);
+    t->wait_rwlock = NULL;
+}
+
+/* Passes RWLOCK, which no thread holds for writing, to the
+   threads waiting for it, if it is free for them: to the
+   upgrader once it is the last reader, or else, once there are
+   no readers, to the highest-priority writer, or to every
+   waiting reader if those have a higher priority.  Then
+   recomputes the priorities donated to the holders.
+
+   Waking up a thread may yield the CPU to it, so the threads
+   that get the lock are only woken up, in a batch, once RWLOCK
+   is in a consistent state again.  Until then they are kept in
+   a local list through their `elem' members, which blocked
+   threads do not use.
+
+   Must be called with interrupts turned off. */
+static void
+rwlock_grant(struct rwlock *rwlock)
+{
+    struct heap *readers = &rwlock->read_waiters;
+    struct heap *writers = &rwlock->write_waiters;
+    struct list woken;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(rwlock->writer == NULL);
+
+    list_init(&woken);
+    if (rwlock->upgrader != NULL)
+    {
+        struct thread *t = rwlock->upgrader;
+        struct rwlock_reader *r;
+
+        if (rwlock->reader_cnt > 1)
+            return;
+        r = rwlock_find_reader(rwlock, t);
+        list_remove(&r->elem);
+        heap_remove(&t->held_locks, &r->hold.elem);
+        r->rwlock = NULL;
+        rwlock->reader_cnt--;
+        rwlock->upgrader = NULL;
+        rwlock->writer = t;
+        heap_push(&t->held_locks, &rwlock->write_hold.elem);
+        t->wait_rwlock = NULL;
+        if (t->status == THREAD_BLOCKED)
+            list_push_back(&woken, &t->elem);
+    }
+    else if (rwlock->reader_cnt == 0)
+    {
+        if (!heap_empty(writers)
+            && (heap_empty(readers)
+                || heap_entry(heap_top(writers), struct thread, waitelem)->priority
+                       >= heap_entry(heap_top(readers), struct thread, waitelem)->priority))
+        {
+            struct thread *t = heap_entry(heap_pop(writers), struct thread, waitelem);
+
+            rwlock_stop_waiting(t);
+            rwlock->writer = t;
+            heap_push(&t->held_locks, &rwlock->write_hold.elem);
+            list_push_back(&woken, &t->elem);
+        }
+        else
+            while (!heap_empty(readers))
+            {
+                struct thread *t = heap_entry(heap_pop(readers), struct thread, waitelem);
+
+                rwlock_stop_waiting(t);
+                rwlock_add_reader(rwlock, t);
+                list_push_back(&woken, &t->elem);
+            }
+    }
+    rwlock_update_holds(rwlock);
+
+    while (!list_empty(&woken))
+    {
+        struct thread *t = list_entry(list_pop_front(&woken), struct thread, elem);
+        thread_unblock(t);
+    }
+}
+
+/* Sets the priority donated to each holder of RWLOCK to that of
+   the threads still waiting for it, and recomputes the holders'
+   priorities.  Must be called with interrupts turned off. */
+static void
+rwlock_update_holds(struct rwlock *rwlock)
+{
+    int priority = rwlock_waiters_priority(rwlock);
+    struct list_elem *e;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (rwlock->writer != NULL)
+    {
+        rwlock->write_hold.priority = priority;
+        heap_update(&rwlock->writer->held_locks, &rwlock->write_hold.elem);
+        if (!thread_mlfqs && !thread_cfs)
+            thread_change_priority(rwlock->writer, thread_effective_priority(rwlock->writer));
+    }
+    for (e = list_begin(&rwlock->readers); e != list_end(&rwlock->readers); e = list_next(e))
+    {
+        struct rwlock_reader *r = list_entry(e, struct rwlock_reader, elem);
+
+        r->hold.priority = priority;
+        heap_update(&r->thread->held_locks, &r->hold.elem);
+        if (!thread_mlfqs && !thread_cfs)
+            thread_change_priority(r->thread, thread_effective_priority(r->thread));
+    }
 }
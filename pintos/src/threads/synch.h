@@ -1,31 +1,99 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+struct cont;
+struct thread;
 
 /* A counting semaphore. */
 struct semaphore
 {
     unsigned value;      /* Current value. */
-    struct list waiters; /* List of waiting threads. */
+    struct heap waiters; /* Waiting threads, by priority. */
+    struct list conts;   /* Waiting continuations, in FIFO order. */
 };
 
 void sema_init(struct semaphore *, unsigned value);
 void sema_down(struct semaphore *);
+bool sema_down_timeout(struct semaphore *, int64_t ticks);
+bool sema_down_cancelable(struct semaphore *);
+void sema_cancel(struct thread *);
 bool sema_try_down(struct semaphore *);
+void sema_down_async(struct semaphore *, struct cont *);
 void sema_up(struct semaphore *);
 void sema_self_test(void);
 
+/* A thread's hold on a lock, through which the threads waiting
+   for the lock donate their priority.  Kept in the holding
+   thread's held_locks heap. */
+struct hold
+{
+    int priority;          /* Priority donated to holder. */
+    struct heap_elem elem; /* Heap element for holder's held locks. */
+};
+
 /* Lock. */
 struct lock
 {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct hold hold;           /* Holder's hold on the lock. */
+#ifdef LOCK_STAT
+    struct lock_class *class;   /* Contention statistics. */
+    uint64_t acquired;          /* TSC when last acquired. */
+#endif
+};
+
+#ifdef LOCK_STAT
+/* Number of call sites kept as a lock class's top waiters. */
+#define LOCK_STAT_WAITERS 4
+
+/* A caller of lock_acquire() that had to wait. */
+struct lock_waiter
+{
+    void *caller;               /* Return address of lock_acquire(). */
+    long long wait_cnt;         /* # of times it waited. */
+    uint64_t wait_sum;          /* Total wait, in TSC cycles. */
 };
 
+/* Contention statistics, built in with "make LOCK_STAT=1", shared
+   by all the locks initialized by one lock_init() call.  Times
+   are in TSC cycles. */
+struct lock_class
+{
+    const char *name;           /* Argument to lock_init(). */
+    const char *file;           /* Source file of lock_init() call. */
+    int line;                   /* Source line of lock_init() call. */
+    bool registered;            /* In list of all classes? */
+    long long acquire_cnt;      /* # of acquisitions. */
+    long long contended_cnt;    /* # of acquisitions that had to wait. */
+    uint64_t wait_sum;          /* Total time waiting. */
+    uint64_t wait_max;          /* Longest wait. */
+    uint64_t hold_sum;          /* Total time held. */
+    uint64_t hold_max;          /* Longest hold. */
+    struct lock_waiter waiters[LOCK_STAT_WAITERS]; /* Top waiters. */
+    struct list_elem elem;      /* Element in list of all classes. */
+};
+
+/* Initializes LOCK, giving it the class of this call site. */
+#define lock_init(LOCK)                                              \
+    do                                                               \
+    {                                                                \
+        static struct lock_class lock_class_ =                       \
+            {.name = #LOCK, .file = __FILE__, .line = __LINE__};     \
+        lock_init_class(LOCK, &lock_class_);                         \
+    } while (0)
+void lock_init_class(struct lock *, struct lock_class *);
+void lock_print_stats(void);
+#else
 void lock_init(struct lock *);
+#endif
 void lock_acquire(struct lock *);
+bool lock_acquire_timeout(struct lock *, int64_t ticks);
 bool lock_try_acquire(struct lock *);
 void lock_release(struct lock *);
 bool lock_held_by_current_thread(const struct lock *);
@@ -33,14 +101,51 @@ bool lock_held_by_current_thread(const struct lock *);
 /* Condition variable. */
 struct condition
 {
-    struct list waiters; /* List of waiting threads. */
+    struct heap waiters; /* Waiting semaphore_elems, by priority. */
 };
 
 void cond_init(struct condition *);
 void cond_wait(struct condition *, struct lock *);
+bool cond_wait_timeout(struct condition *, struct lock *, int64_t ticks);
 void cond_signal(struct condition *, struct lock *);
 void cond_broadcast(struct condition *, struct lock *);
 
+/* Maximum number of reader-writer locks a thread may hold for
+   reading at once. */
+#define RWLOCK_READS_MAX 4
+
+/* A thread's hold on a reader-writer lock for reading.  Each
+   thread has RWLOCK_READS_MAX of these. */
+struct rwlock_reader
+{
+    struct rwlock *rwlock;  /* Lock held for reading, or null. */
+    struct thread *thread;  /* Reading thread. */
+    struct hold hold;       /* Reader's hold on the lock. */
+    struct list_elem elem;  /* List element for lock's readers. */
+};
+
+/* Reader-writer lock.  Any number of readers or a single writer
+   may hold it at once.  Writers are preferred: once a writer is
+   waiting, new readers wait behind it. */
+struct rwlock
+{
+    struct list readers;        /* Readers' rwlock_readers. */
+    size_t reader_cnt;          /* Number of readers. */
+    struct thread *writer;      /* Thread holding lock for writing. */
+    struct hold write_hold;     /* Writer's hold on the lock. */
+    struct thread *upgrader;    /* Reader waiting to upgrade, or null. */
+    struct heap read_waiters;   /* Threads waiting to read, by priority. */
+    struct heap write_waiters;  /* Threads waiting to write, by priority. */
+};
+
+void rwlock_init(struct rwlock *);
+void rwlock_acquire_read(struct rwlock *);
+void rwlock_release_read(struct rwlock *);
+void rwlock_acquire_write(struct rwlock *);
+void rwlock_release_write(struct rwlock *);
+bool rwlock_upgrade(struct rwlock *);
+bool rwlock_held_by_current_thread(const struct rwlock *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
@@ -2,14 +2,17 @@
 #include <debug.h>
 #include <stddef.h>
 #include <random.h>
+#include <rbtree.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/tsc.h"
 #include "threads/vaddr.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -22,13 +25,29 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
-
-/* List of slept processes in THREAD_BLOCKED state, that is,
-   processes that are slept by timer_sleep(). */
-static struct list sleep_list;
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO list per priority level, and bit P of
+   ready_bitmap is set if and only if ready_queues[P] is not
+   empty, so that the highest-priority ready thread can be found
+   in constant time. */
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_bitmap;
+static int ready_cnt; /* # of threads in the run queue. */
+
+/* Run queue for the completely fair scheduler, used instead of
+   ready_queues when thread_cfs is true.  Ready threads are kept
+   in a red-black tree ordered by virtual runtime, so the thread
+   that has received the least weighted CPU time is leftmost. */
+static struct rb_tree cfs_queue;
+
+/* Run queue for periodic threads, ordered earliest deadline
+   first.  Periodic threads in it run ahead of all threads in
+   ready_queues or cfs_queue.  ready_cnt counts them, too. */
+static struct heap edf_queue;
+
+/* Deadline statistics of all periodic threads so far. */
+static struct periodic_stats edf_stats;
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
@@ -55,6 +74,22 @@ struct kernel_thread_frame
 static long long idle_ticks;   /* # of timer ticks spent idle. */
 static long long kernel_ticks; /* # of timer ticks in kernel threads. */
 static long long user_ticks;   /* # of timer ticks in user programs. */
+static long long handoff_cnt;  /* # of direct switches to woken threads. */
+static long long create_cnt;   /* # of threads created. */
+static uint64_t create_cycles; /* CPU cycles spent in thread_create(). */
+
+/* Cache of pages of threads that have died, reused by
+   thread_create() before it asks the page allocator for a new
+   one.  This saves a bitmap scan in palloc_get_page() and the
+   zeroing of a whole page, as only the struct thread at the
+   bottom of a page needs to be cleared.  Kept as a stack, so that
+   the page reused is the one most likely still in the cache of
+   the CPU.  Accessed with interrupts turned off. */
+#define THREAD_CACHE_SIZE 16
+static struct thread *thread_cache[THREAD_CACHE_SIZE];
+static int thread_cache_cnt;
+static long long thread_cache_hits;   /* # of pages reused. */
+static long long thread_cache_misses; /* # of pages from palloc. */
 
 /* Scheduling. */
 #define TIME_SLICE 4          /* # of timer ticks to give each thread. */
@@ -65,9 +100,86 @@ static unsigned thread_ticks; /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-o cfs". */
+bool thread_cfs;
+
+/* Completely fair scheduler.
+
+   Each thread's vruntime counts the CPU time it has received,
+   scaled by NICE_0_WEIGHT / weight, in units of 1/NICE_0_WEIGHT
+   of a tick.  The ready thread with the least vruntime runs next,
+   so over time each runnable thread receives CPU time in
+   proportion to its weight, which is set by its nice value.
+
+   The running thread is preempted once it has run for its share
+   of CFS_LATENCY ticks, but never before it has run for
+   CFS_MIN_GRANULARITY ticks.  min_vruntime follows the least
+   vruntime among runnable threads and never decreases; threads
+   that wake up or are created are placed relative to it. */
+#define NICE_0_WEIGHT 1024      /* Weight of a thread with nice 0. */
+#define CFS_LATENCY 8           /* Ticks to run every thread once. */
+#define CFS_MIN_GRANULARITY 1   /* Least ticks to run before preemption. */
+#define CFS_WAKEUP_GRANULARITY 1 /* Ticks of lead needed to preempt. */
+static int64_t min_vruntime;
+static int cfs_ready_weight; /* Sum of weights of ready threads. */
+
+/* Weight for each nice value from NICE_MIN to NICE_MAX.  Each
+   step in nice changes the share of CPU time by about 10%. */
+static const int cfs_weights[NICE_MAX - NICE_MIN + 1] = {
+    88761, 71755, 56483, 46273, 36291, /* -20 ... -16 */
+    29154, 23254, 18705, 14949, 11916, /* -15 ... -11 */
+    9548, 7620, 6100, 4904, 3906,      /* -10 ... -6 */
+    3121, 2501, 1991, 1586, 1277,      /* -5 ... -1 */
+    1024, 820, 655, 526, 423,          /* 0 ... 4 */
+    335, 272, 215, 172, 137,           /* 5 ... 9 */
+    110, 87, 70, 56, 45,               /* 10 ... 14 */
+    36, 29, 23, 18, 15,                /* 15 ... 19 */
+    12,                                /* 20 */
+};
+
 /* Average number of threads to run over the past time. */
 static int load_avg;
 
+/* Lazy recent_cpu decay for the multi-level feedback queue
+   scheduler.
+
+   Once per second, every thread's recent_cpu decays by a factor
+   that depends on load_avg.  Threads that are running or ready
+   decay right away, because their priorities decide what runs
+   next.  So do blocked threads that wait in a semaphore's,
+   condition variable's, or reader-writer lock's waiters heap,
+   which wakes its highest-priority waiter first; they are kept
+   in waiter_list.  Any other blocked thread's priority does not
+   matter until it is unblocked, so its decay is deferred until
+   then.  decay_epoch
+   counts the seconds so far, decay_coef remembers each second's
+   factor, and each thread records in its own decay_epoch how
+   many decays it has received.
+
+   Blocked threads wait in decay_list in the order they blocked,
+   so the thread at the front is always the one furthest behind.
+   Once per second, threads about to fall further behind than
+   decay_coef can remember are caught up and moved to the back.
+   This costs amortized 1/DECAY_HISTORY of a decay per blocked
+   thread per second.
+
+   The ready threads and the threads in waiter_list are still
+   decayed, and their priorities recomputed, once per second in
+   the timer interrupt, which takes time linear in their
+   number. */
+#define DECAY_HISTORY 64
+static int decay_epoch;
+static int decay_coef[DECAY_HISTORY];
+static struct list decay_list;
+static struct list waiter_list;
+
+/* Non-idle threads that ran during the current time slice.  Only
+   their recent_cpu, and thus their priority, changed since the
+   last time slice. */
+static struct thread *ran_threads[TIME_SLICE];
+static int ran_cnt;
+
 static void kernel_thread(thread_func *, void *aux);
 
 static void idle(void *aux UNUSED);
@@ -77,11 +189,33 @@ static void init_thread(struct thread *, const char *name, int priority);
 static bool is_thread(struct thread *) UNUSED;
 static void *alloc_frame(struct thread *, size_t size);
 static void schedule(void);
+static struct thread *new_thread(const char *name, int priority, thread_func *, void *aux);
+static bool is_periodic(const struct thread *);
+static bool thread_preempts(struct thread *t, struct thread *cur);
+static bool thread_runs_next(struct thread *);
+static thread_func periodic_main NO_RETURN;
+static timeout_func periodic_release;
+static heap_less_func less_deadline;
+static void schedule_to(struct thread *);
+static void thread_handoff(struct thread *);
 void thread_schedule_tail(struct thread *prev);
 static tid_t allocate_tid(void);
+static struct thread *thread_page_get(void);
+static void thread_page_put(struct thread *);
 static thread_action_func update_priority;
-static thread_action_func update_recent_cpu;
 static void update_load_avg(void);
+static bool update_recent_cpu(struct thread *);
+static void mlfqs_second(void);
+static void mlfqs_slice(void);
+static void ready_queue_push(struct thread *);
+static void ready_queue_remove(struct thread *);
+static struct thread *ready_queue_pop(void);
+static int ready_queue_max_priority(void);
+static rb_less_func less_vruntime;
+static heap_less_func less_hold_priority;
+static void cfs_tick(struct thread *);
+static void cfs_place(struct thread *, bool initial);
+static bool cfs_should_preempt(struct thread *cur, struct thread *t);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -98,11 +232,18 @@ static void update_load_avg(void);
    finishes. */
 void thread_init(void)
 {
+    int pri;
+
     ASSERT(intr_get_level() == INTR_OFF);
 
     lock_init(&tid_lock);
-    list_init(&ready_list);
+    for (pri = PRI_MIN; pri <= PRI_MAX; pri++)
+        list_init(&ready_queues[pri]);
+    rb_init(&cfs_queue, less_vruntime, NULL);
+    heap_init(&edf_queue, less_deadline, NULL);
     list_init(&all_list);
+    list_init(&decay_list);
+    list_init(&waiter_list);
     if (thread_mlfqs)
         load_avg = int_to_fixed(0);
 
@@ -150,36 +291,103 @@ void thread_tick(void)
     {
         int64_t ticks = timer_ticks();
 
-        t->recent_cpu = fixed_plus_int(t->recent_cpu, 1);
-        if (ticks % TIMER_FREQ == 0)
+        if (t != idle_thread)
         {
-            update_load_avg();
-            thread_foreach(update_recent_cpu, NULL);
+            int i;
+
+            t->recent_cpu = fixed_plus_int(t->recent_cpu, 1);
+            for (i = 0; i < ran_cnt; i++)
+                if (ran_threads[i] == t)
+                    break;
+            if (i == ran_cnt)
+            {
+                ASSERT(ran_cnt < TIME_SLICE);
+                ran_threads[ran_cnt++] = t;
+            }
         }
+        if (ticks % TIMER_FREQ == 0)
+            mlfqs_second();
         if (ticks % TIME_SLICE == 0)
         {
-            thread_foreach(update_priority, NULL);
-
-            if (!list_empty(&ready_list))
-            {
-                struct list_elem *max_e = list_max(&ready_list, less_priority, NULL);
+            mlfqs_slice();
 
-                if (t->priority < list_entry(max_e, struct thread, elem)->priority)
-                    intr_yield_on_return();
-            }
+            if (!is_periodic(t) && t->priority < ready_queue_max_priority())
+                intr_yield_on_return();
         }
     }
 
+    /* Hold a periodic thread to its budget. */
+    if (is_periodic(t) && ++t->edf.used >= t->edf.budget && !t->edf.throttled)
+    {
+        t->edf.throttled = true;
+        t->edf.stats.throttles++;
+        edf_stats.throttles++;
+        intr_yield_on_return();
+    }
+
+    if (thread_schedstat)
+        schedstat_tick(ready_cnt);
+
     /* Enforce preemption. */
-    if (++thread_ticks >= TIME_SLICE)
+    ++thread_ticks;
+    if (thread_cfs)
+    {
+        if (t != idle_thread && !is_periodic(t))
+            cfs_tick(t);
+    }
+    else if (thread_ticks >= TIME_SLICE)
         intr_yield_on_return();
 }
 
+/* Accounts for CNT timer ticks, ending just before the current
+   one, that passed without a timer interrupt because the CPU was
+   idle in tickless mode.  Catches up the statistics and, in mlfqs
+   mode, the end-of-slice and once-per-second updates that those
+   ticks would have made.  Only the first slice boundary matters,
+   since no thread ran after it.  Called by the timer interrupt
+   handler. */
+void thread_skip_ticks(int cnt)
+{
+    int64_t now = timer_ticks();
+    int64_t seconds = now / TIMER_FREQ - (now - cnt) / TIMER_FREQ;
+    int64_t slice_end = ((now - cnt) / TIME_SLICE + 1) * TIME_SLICE;
+
+    ASSERT(intr_context());
+
+    idle_ticks += cnt;
+    if (thread_mlfqs && slice_end <= now)
+    {
+        /* Same order as in thread_tick(). */
+        if (slice_end % TIMER_FREQ == 0)
+        {
+            mlfqs_second();
+            seconds--;
+        }
+        mlfqs_slice();
+        while (seconds-- > 0)
+            mlfqs_second();
+    }
+}
+
 /* Prints thread statistics. */
 void thread_print_stats(void)
 {
-    printf("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
-           idle_ticks, kernel_ticks, user_ticks);
+    printf("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks, "
+           "%lld handoffs\n",
+           idle_ticks, kernel_ticks, user_ticks, handoff_cnt);
+    if (thread_schedstat)
+        schedstat_print();
+    if (edf_stats.jobs > 0 || edf_stats.misses > 0)
+        printf("Thread: %lld periodic jobs, %lld deadline misses, "
+               "%lld throttles, release jitter %llu cycles on average, "
+               "%llu at most\n",
+               edf_stats.jobs, edf_stats.misses, edf_stats.throttles,
+               edf_stats.jobs > 0 ? edf_stats.jitter_sum / edf_stats.jobs : 0,
+               edf_stats.jitter_max);
+    printf("Thread: %lld created, %lld pages reused, %lld pages allocated, "
+           "%llu cycles per creation\n",
+           create_cnt, thread_cache_hits, thread_cache_misses,
+           create_cnt > 0 ? create_cycles / create_cnt : 0);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -199,23 +407,113 @@ void thread_print_stats(void)
    Priority scheduling is the goal of Problem 1-3. */
 tid_t thread_create(const char *name, int priority,
                     thread_func *function, void *aux)
+{
+    struct thread *t;
+    tid_t tid;
+
+    t = new_thread(name, priority, function, aux);
+    if (t == NULL)
+        return TID_ERROR;
+    tid = t->tid;
+
+    /* Add to run queue. */
+    thread_unblock(t);
+
+    return tid;
+}
+
+/* Creates a new periodic kernel thread named NAME, which runs
+   FUNCTION, passing AUX as the argument, once every PERIOD timer
+   ticks, starting now, until FUNCTION calls thread_exit().  Each
+   run is a job, due by the start of the next period.  Returns the
+   thread identifier for the new thread, or TID_ERROR if creation
+   fails.
+
+   Periodic threads run ahead of all other threads, the one with
+   the earliest deadline first.  A periodic thread runs for at
+   most BUDGET ticks per period; once it has used them up, it
+   waits for its next period even if its job is not done.  A job
+   that is not done by its deadline is counted as a miss, and the
+   next job starts as soon as it is done.
+
+   Periodic threads have priority PRI_MAX, which they donate to
+   the holders of locks they wait for. */
+tid_t thread_create_periodic(const char *name, int64_t period, int64_t budget,
+                             thread_func *function, void *aux)
+{
+    struct thread *t;
+    struct periodic *p;
+    enum intr_level old_level;
+    tid_t tid;
+
+    ASSERT(function != NULL);
+    ASSERT(period > 0);
+    ASSERT(0 < budget && budget <= period);
+
+    t = new_thread(name, PRI_MAX, periodic_main, NULL);
+    if (t == NULL)
+        return TID_ERROR;
+    tid = t->tid;
+
+    t->priority = t->original_priority = PRI_MAX;
+    p = &t->edf;
+    p->period = period;
+    p->budget = budget;
+    p->function = function;
+    p->aux = aux;
+    timeout_init(&p->timeout, periodic_release, t);
+
+    old_level = intr_disable();
+    p->release = timer_ticks();
+    p->deadline = p->release + period;
+    p->pending = true;
+    p->fresh = true;
+    p->release_tsc = rdtsc();
+    timeout_arm(&p->timeout, p->deadline);
+    thread_unblock(t);
+    intr_set_level(old_level);
+
+    return tid;
+}
+
+/* Copies the deadline statistics of the running thread, which
+   must be periodic, into *STATS. */
+void thread_get_periodic_stats(struct periodic_stats *stats)
+{
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+
+    ASSERT(is_periodic(cur));
+
+    old_level = intr_disable();
+    *stats = cur->edf.stats;
+    intr_set_level(old_level);
+}
+
+/* Allocates and initializes a thread named NAME with the given
+   initial PRIORITY, which will execute FUNCTION passing AUX as
+   the argument, and returns it, still blocked.  Returns a null
+   pointer if there is no memory for it. */
+static struct thread *
+new_thread(const char *name, int priority, thread_func *function, void *aux)
 {
     struct thread *t;
     struct kernel_thread_frame *kf;
     struct switch_entry_frame *ef;
     struct switch_threads_frame *sf;
-    tid_t tid;
+    enum intr_level old_level;
+    uint64_t start = rdtsc();
 
     ASSERT(function != NULL);
 
     /* Allocate thread. */
-    t = palloc_get_page(PAL_ZERO);
+    t = thread_page_get();
     if (t == NULL)
-        return TID_ERROR;
+        return NULL;
 
     /* Initialize thread. */
     init_thread(t, name, priority);
-    tid = t->tid = allocate_tid();
+    t->tid = allocate_tid();
 
     /* Stack frame for kernel_thread(). */
     kf = alloc_frame(t, sizeof *kf);
@@ -234,14 +532,17 @@ tid_t thread_create(const char *name, int priority,
 
 #ifdef VM
     spt_init (&t->supplemental_page_table, &t->supplemental_page_table_lock);
+    lock_init (&t->fault_lock);
     list_init (&t->mmap_table);
     t->max_mapid = 0;
 #endif
 
-    /* Add to run queue. */
-    thread_unblock(t);
+    old_level = intr_disable();
+    create_cnt++;
+    create_cycles += rdtsc() - start;
+    intr_set_level(old_level);
 
-    return tid;
+    return t;
 }
 
 /* Puts the current thread to sleep.  It will not be scheduled
@@ -252,22 +553,43 @@ tid_t thread_create(const char *name, int priority,
    primitives in synch.h. */
 void thread_block(void)
 {
+    thread_block_for(WAIT_OTHER);
+}
+
+/* Like thread_block(), but records REASON as what the thread
+   waits for, in the scheduler statistics. */
+void thread_block_for(enum wait_reason reason)
+{
+    struct thread *cur = thread_current();
+
     ASSERT(!intr_context());
     ASSERT(intr_get_level() == INTR_OFF);
 
-    thread_current()->status = THREAD_BLOCKED;
+    if (thread_schedstat && cur != idle_thread)
+        schedstat_block(cur, reason);
+    cur->status = THREAD_BLOCKED;
+    if (thread_mlfqs && cur != idle_thread)
+    {
+        if (cur->wait_queue != NULL)
+            cur->decay_waiting = true;
+        else
+            cur->decay_deferred = true;
+        list_push_back(cur->decay_waiting ? &waiter_list : &decay_list,
+                       &cur->decayelem);
+    }
     schedule();
 }
 
 /* Transitions a blocked thread T to the ready-to-run state.
    This is an error if T is not blocked.  (Use thread_yield() to
    make the running thread ready.) If the current thread has
-   lower priority than T, it should yield.
+   lower priority than T, it yields, switching directly to T
+   when T is the highest-priority ready thread.
 
-   This function does not preempt the running thread.  This can
-   be important: if the caller had disabled interrupts itself,
-   it may expect that it can atomically unblock a thread and
-   update other data. */
+   Because the caller may be switched away from before this
+   function returns, even with interrupts off, it must finish
+   updating any data that T depends on before calling it, as
+   sema_up() does by incrementing the semaphore's value first. */
 void thread_unblock(struct thread *t)
 {
     enum intr_level old_level;
@@ -277,9 +599,34 @@ void thread_unblock(struct thread *t)
 
     old_level = intr_disable();
     ASSERT(t->status == THREAD_BLOCKED);
-    list_push_back(&ready_list, &t->elem);
+    if (thread_schedstat)
+        schedstat_wakeup(t);
+    if (thread_mlfqs)
+    {
+        if (t->decay_deferred || t->decay_waiting)
+        {
+            list_remove(&t->decayelem);
+            t->decay_deferred = t->decay_waiting = false;
+        }
+        if (update_recent_cpu(t))
+            update_priority(t, NULL);
+    }
+    if (thread_cfs && !is_periodic(t))
+        cfs_place(t, false);
     t->status = THREAD_READY;
-    if (cur != idle_thread && t->priority > cur->priority)
+
+    /* A thread woken up by a running thread that it preempts, and
+       that beats every other ready thread, is switched to
+       directly instead of going through the run queue. */
+    if (cur != idle_thread && !intr_context() && thread_preempts(t, cur) && thread_runs_next(t))
+    {
+        thread_handoff(t);
+        intr_set_level(old_level);
+        return;
+    }
+
+    ready_queue_push(t);
+    if (cur != idle_thread && thread_preempts(t, cur))
         if (intr_context())
             intr_yield_on_return();
         else
@@ -328,12 +675,23 @@ void thread_exit(void)
 #ifdef USERPROG
     process_exit();
 #endif
+    fpu_exit();
 
     /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
     intr_disable();
     list_remove(&thread_current()->allelem);
+    if (is_periodic(thread_current()))
+        timeout_cancel(&thread_current()->edf.timeout);
+    if (thread_mlfqs)
+    {
+        int i;
+
+        for (i = 0; i < ran_cnt; i++)
+            if (ran_threads[i] == thread_current())
+                ran_threads[i--] = ran_threads[--ran_cnt];
+    }
     thread_current()->status = THREAD_DYING;
     schedule();
     NOT_REACHED();
@@ -349,9 +707,17 @@ void thread_yield(void)
     ASSERT(!intr_context());
 
     old_level = intr_disable();
-    if (cur != idle_thread)
-        list_push_back(&ready_list, &cur->elem);
+    if (cur->edf.throttled)
+    {
+        /* A periodic thread out of budget waits for its next
+           release instead. */
+        thread_block_for(WAIT_PERIOD);
+        intr_set_level(old_level);
+        return;
+    }
     cur->status = THREAD_READY;
+    if (cur != idle_thread)
+        ready_queue_push(cur);
     schedule();
     intr_set_level(old_level);
 }
@@ -372,63 +738,117 @@ void thread_foreach(thread_action_func *func, void *aux)
     }
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY.
-   If it is not related to donation, set the original
-   priority, too. If there is donators of the current
-   thread and NEW_PRIORITY is lower than the most
-   powerful donator, just return. If there is any
-   thread with higher priority than the current
-   thread, the current thread should yield. */
+/* Sets the current thread's original priority to NEW_PRIORITY.
+   Its effective priority does not drop below the priority
+   donated to it through the locks it holds.  If there is any
+   thread with higher priority than the current thread, the
+   current thread should yield. */
 void thread_set_priority(int new_priority)
 {
-    if (thread_mlfqs)
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+
+    if (thread_mlfqs || thread_cfs)
         return;
 
-    struct thread *cur = thread_current();
+    old_level = intr_disable();
+    cur->original_priority = new_priority;
+    thread_change_priority(cur, thread_effective_priority(cur));
+    intr_set_level(old_level);
 
-    if (!list_empty(&cur->donators))
-    {
-        struct list_elem *max_e = list_max(&cur->donators, less_priority, 1);
+    if (cur->priority < ready_queue_max_priority())
+        thread_yield();
+}
 
-        if (new_priority < list_entry(max_e, struct thread, doelem)->priority)
-        {
-            cur->original_priority = new_priority;
-            return;
-        }
+/* Changes the effective priority of T to PRIORITY, e.g. because
+   of priority donation.  If T is ready to run, it is moved to
+   the back of the run queue for its new priority.  If T is
+   in a wait queue, it is moved to its new place there. */
+void thread_change_priority(struct thread *t, int priority)
+{
+    enum intr_level old_level;
+
+    ASSERT(t != NULL);
+    ASSERT(PRI_MIN <= priority && priority <= PRI_MAX);
+
+    old_level = intr_disable();
+    if (t->status == THREAD_READY && t != idle_thread && t->priority != priority && !thread_cfs)
+    {
+        ready_queue_remove(t);
+        t->priority = priority;
+        ready_queue_push(t);
     }
     else
-        cur->original_priority = new_priority;
-
-    cur->priority = new_priority;
-    if (!list_empty(&ready_list))
     {
-        struct list_elem *max_e = list_max(&ready_list, less_priority, NULL);
+        t->priority = priority;
+        if (t->wait_queue != NULL)
+            heap_update(t->wait_queue, t->wait_elem);
+    }
+    intr_set_level(old_level);
+}
 
-        if (cur->priority < list_entry(max_e, struct thread, elem)->priority)
-            thread_yield();
+/* Records that thread T waits in QUEUE through ELEM, so
+   that a change in T's priority re-keys it there.  Pass null
+   pointers once T has been taken out of QUEUE.  Must be called
+   with interrupts turned off. */
+void thread_set_wait_queue(struct thread *t, struct heap *queue, struct heap_elem *elem)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    t->wait_queue = queue;
+    t->wait_elem = elem;
+}
+
+/* Returns T's priority taking donation into account: the
+   higher of its original priority and the highest priority
+   donated through a lock it holds.  Takes constant time, because
+   T's held locks are kept in a heap by donated priority. */
+int thread_effective_priority(struct thread *t)
+{
+    int priority = t->original_priority;
+
+    if (!heap_empty(&t->held_locks))
+    {
+        struct hold *hold = heap_entry(heap_top(&t->held_locks), struct hold, elem);
+        if (hold->priority > priority)
+            priority = hold->priority;
     }
+    return priority;
 }
 
-/* If the current thread has no donators, return its
-   original priority. Otherwise, return the highest
-   priority among donators. */
+/* Returns the current thread's priority.  In the presence of
+   priority donation, returns the higher (donated) priority. */
 int thread_get_priority(void)
 {
     struct thread *cur = thread_current();
 
-    if (thread_mlfqs || list_empty(&cur->donators))
+    if (thread_mlfqs || thread_cfs)
         return cur->original_priority;
-
-    struct list_elem *max_e = list_max(&cur->donators, less_priority, 1);
-    return list_entry(max_e, struct thread, doelem)->priority;
+    return cur->priority;
 }
 
 /* Sets the current thread's nice value to NEW_NICE. */
 void thread_set_nice(int new_nice)
 {
     struct thread *cur = thread_current();
+
+    ASSERT(NICE_MIN <= new_nice && new_nice <= NICE_MAX);
+
     cur->nice = new_nice;
-    update_priority(cur, 1);
+    if (thread_cfs)
+    {
+        enum intr_level old_level = intr_disable();
+        cur->weight = cfs_weights[new_nice - NICE_MIN];
+        if (!rb_empty(&cfs_queue))
+        {
+            struct thread *t = rb_entry(rb_min(&cfs_queue), struct thread, cfselem);
+            if (cfs_should_preempt(cur, t))
+                thread_yield();
+        }
+        intr_set_level(old_level);
+    }
+    else
+        update_priority(cur, 1);
 }
 
 /* Returns the current thread's nice value. */
@@ -458,30 +878,6 @@ int thread_get_recent_cpu(void)
     return ret;
 }
 
-/* Returns sleep list */
-struct list *get_sleep_list(void)
-{
-    return &sleep_list;
-}
-
-/* Returns the current thread's donators list. */
-struct list *thread_get_donators(void)
-{
-    return &thread_current()->donators;
-}
-
-/* Sets the current thread's donee to NEW_DONEE. */
-void thread_set_donee(struct thread *new_donee)
-{
-    thread_current()->donee = new_donee;
-}
-
-/* Returns the current thread's donee. */
-struct thread *thread_get_donee(void)
-{
-    return thread_current()->donee;
-}
-
 #ifdef USERPROG
 
 /* Sets the current thread's pagedir to NEW_PAGEDIR. */
@@ -502,29 +898,29 @@ void thread_set_pcb(struct process *new_pcb)
     thread_current()->pcb = new_pcb;
 }
 
-/* Returns the current thread's pcb. */
+/* Returns the current process's pcb. */
 struct process *thread_get_pcb(void)
 {
-    return thread_current()->pcb;
+    return thread_current()->leader->pcb;
 }
 
-/* Returns the current thread's children. */
+/* Returns the current process's children. */
 struct list *thread_get_children(void)
 {
-    return &thread_current()->children;
+    return &thread_current()->leader->children;
 }
 
-/* Returns the current thread's fdt. */
+/* Returns the current process's fdt. */
 struct list *thread_get_fdt(void)
 {
-    return &thread_current()->fdt;
+    return &thread_current()->leader->fdt;
 }
 
-/* Returns the current thread's next_fd and increments
+/* Returns the current process's next_fd and increments
    it by 1. */
 int thread_get_next_fd(void)
 {
-    return thread_current()->next_fd++;
+    return thread_current()->leader->next_fd++;
 }
 
 /* Sets the current thread's running_file to NEW_RUNNING_FILE. */
@@ -533,25 +929,23 @@ void thread_set_running_file(struct file *new_running_file)
     thread_current()->running_file = new_running_file;
 }
 
-/* Returns the current thread's running_file. */
+/* Returns the current process's running_file. */
 struct file *thread_get_running_file(void)
 {
-    return thread_current()->running_file;
+    return thread_current()->leader->running_file;
 }
 
 #endif
 
-/* Compares priority of two list elements A and B. If
-   aux is 1, A and B are elements of donators list.
-   Returns true if A is less than B, or false if A is
-   greater than or equal to B. */
-bool less_priority(const struct list_elem *a, const struct list_elem *b, void *aux)
+/* Compares the priorities donated through two holds A and B in
+   a thread's held_locks heap.  Returns true if A is less than B,
+   or false if A is greater than or equal to B. */
+static bool
+less_hold_priority(const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED)
 {
-    const struct thread *a_t = (aux == 1) ? list_entry(a, struct thread, doelem)
-                                          : list_entry(a, struct thread, elem);
-    const struct thread *b_t = (aux == 1) ? list_entry(b, struct thread, doelem)
-                                          : list_entry(b, struct thread, elem);
-    return a_t->priority < b_t->priority;
+    const struct hold *a_h = heap_entry(a, struct hold, elem);
+    const struct hold *b_h = heap_entry(b, struct hold, elem);
+    return a_h->priority < b_h->priority;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -574,8 +968,13 @@ idle(void *idle_started_ UNUSED)
     {
         /* Let someone else run. */
         intr_disable();
+        timer_idle_exit();
         thread_block();
 
+        /* Nothing else to run.  Stop the periodic timer interrupt,
+           if tickless mode is enabled. */
+        timer_idle_enter();
+
         /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -588,6 +987,7 @@ idle(void *idle_started_ UNUSED)
 
          See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
          7.11.1 "HLT Instruction". */
+        intr_trace_end();
         asm volatile("sti; hlt"
                      :
                      :
@@ -644,8 +1044,12 @@ init_thread(struct thread *t, const char *name, int priority)
     strlcpy(t->name, name, sizeof t->name);
     t->stack = (uint8_t *)t + PGSIZE;
     t->priority = t->original_priority = priority;
-    list_init(&t->donators);
-    t->donee = NULL;
+    heap_init(&t->held_locks, less_hold_priority, NULL);
+    t->wait_lock = NULL;
+    t->wait_rwlock = NULL;
+    t->wait_queue = NULL;
+    t->cancel_sema = NULL;
+    t->canceled = false;
     if (thread_mlfqs)
     {
         t->nice = (t == initial_thread)
@@ -654,14 +1058,28 @@ init_thread(struct thread *t, const char *name, int priority)
         t->recent_cpu = (t == initial_thread)
                             ? int_to_fixed(0)
                             : thread_current()->recent_cpu;
+        t->decay_epoch = decay_epoch;
         update_priority(t, NULL);
     }
+    else if (thread_cfs)
+    {
+        t->nice = (t == initial_thread) ? 0 : thread_current()->nice;
+        t->weight = cfs_weights[t->nice - NICE_MIN];
+        cfs_place(t, true);
+    }
 
 #ifdef USERPROG
     t->pcb = NULL;
     list_init(&t->children);
     list_init(&t->fdt);
     t->next_fd = 2;
+    t->leader = t;
+    t->uthread = NULL;
+    list_init(&t->uthreads);
+    lock_init(&t->uthread_lock);
+    lock_init(&t->children_lock);
+    t->uthread_slots = 1;
+    t->exiting = false;
 #endif
 
     t->magic = THREAD_MAGIC;
@@ -693,16 +1111,114 @@ alloc_frame(struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run(void)
 {
-    if (list_empty(&ready_list))
+    if (ready_cnt == 0)
         return idle_thread;
     else
+        return ready_queue_pop();
+}
+
+/* Appends T to the run queue for its priority, or under the
+   completely fair scheduler, inserts it by virtual runtime.  A
+   periodic thread goes into the EDF run queue instead. */
+static void
+ready_queue_push(struct thread *t)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(t->status == THREAD_READY);
+
+    if (is_periodic(t))
+    {
+        heap_push(&edf_queue, &t->edf.elem);
+        ready_cnt++;
+        return;
+    }
+    if (thread_cfs)
     {
-        struct list_elem *max_e = list_max(&ready_list, less_priority, NULL);
-        struct thread *max_t = list_entry(max_e, struct thread, elem);
+        rb_insert(&cfs_queue, &t->cfselem);
+        cfs_ready_weight += t->weight;
+        ready_cnt++;
+        return;
+    }
+    list_push_back(&ready_queues[t->priority], &t->elem);
+    ready_bitmap |= (uint64_t)1 << t->priority;
+    ready_cnt++;
+}
 
-        list_remove(max_e);
-        return max_t;
+/* Removes T from the run queue. */
+static void
+ready_queue_remove(struct thread *t)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(t->status == THREAD_READY);
+
+    if (is_periodic(t))
+    {
+        heap_remove(&edf_queue, &t->edf.elem);
+        ready_cnt--;
+        return;
+    }
+    if (thread_cfs)
+    {
+        rb_remove(&cfs_queue, &t->cfselem);
+        cfs_ready_weight -= t->weight;
+        ready_cnt--;
+        return;
     }
+    list_remove(&t->elem);
+    if (list_empty(&ready_queues[t->priority]))
+        ready_bitmap &= ~((uint64_t)1 << t->priority);
+    ready_cnt--;
+}
+
+/* Removes and returns the periodic thread with the earliest
+   deadline, if any, or else the thread at the front of the
+   highest priority nonempty run queue, or under the completely
+   fair scheduler, the thread with the least virtual runtime.
+   The run queue must not be empty. */
+static struct thread *
+ready_queue_pop(void)
+{
+    struct thread *t;
+    int pri;
+
+    if (!heap_empty(&edf_queue))
+    {
+        ready_cnt--;
+        return heap_entry(heap_pop(&edf_queue), struct thread, edf.elem);
+    }
+    if (thread_cfs)
+    {
+        t = rb_entry(rb_min(&cfs_queue), struct thread, cfselem);
+        ready_queue_remove(t);
+        if (t->vruntime > min_vruntime)
+            min_vruntime = t->vruntime;
+        return t;
+    }
+
+    pri = ready_queue_max_priority();
+    ASSERT(pri >= PRI_MIN);
+
+    t = list_entry(list_front(&ready_queues[pri]), struct thread, elem);
+    ready_queue_remove(t);
+    return t;
+}
+
+/* Returns the highest priority among ready threads, or -1 if
+   the run queue is empty.  Finds the most significant set bit
+   of ready_bitmap one 32-bit half at a time, because `bsr'
+   works on 32-bit operands. */
+static int
+ready_queue_max_priority(void)
+{
+    uint32_t high = ready_bitmap >> 32;
+    uint32_t low = ready_bitmap;
+
+    if (high != 0)
+        return 63 - __builtin_clz(high);
+    else if (low != 0)
+        return 31 - __builtin_clz(low);
+    else
+        return -1;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -733,20 +1249,24 @@ void thread_schedule_tail(struct thread *prev)
     /* Start new time slice. */
     thread_ticks = 0;
 
+    /* Trap the new thread's first use of the FPU, unless its
+       state is already loaded. */
+    fpu_switch(cur);
+
 #ifdef USERPROG
     /* Activate the new address space. */
     process_activate();
 #endif
 
     /* If the thread we switched from is dying, destroy its struct
-     thread.  This must happen late so that thread_exit() doesn't
-     pull out the rug under itself.  (We don't free
+     thread, or keep it for reuse.  This must happen late so that
+     thread_exit() doesn't pull out the rug under itself.  (We don't free
      initial_thread because its memory was not obtained via
      palloc().) */
     if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread)
     {
         ASSERT(prev != cur);
-        palloc_free_page(prev);
+        thread_page_put(prev);
     }
 }
 
@@ -759,9 +1279,18 @@ void thread_schedule_tail(struct thread *prev)
    has completed. */
 static void
 schedule(void)
+{
+    schedule_to(next_thread_to_run());
+}
+
+/* Switches from the running thread, whose state must have been
+   changed from running to some other state, to NEXT, which must
+   not be in the run queue.  Must be called with interrupts
+   off. */
+static void
+schedule_to(struct thread *next)
 {
     struct thread *cur = running_thread();
-    struct thread *next = next_thread_to_run();
     struct thread *prev = NULL;
 
     ASSERT(intr_get_level() == INTR_OFF);
@@ -769,10 +1298,34 @@ schedule(void)
     ASSERT(is_thread(next));
 
     if (cur != next)
+    {
+        if (thread_schedstat)
+            schedstat_switch(cur, next);
         prev = switch_threads(cur, next);
+    }
     thread_schedule_tail(prev);
 }
 
+/* Yields the CPU directly to NEXT, a ready thread that is not
+   in the run queue and preempts the running thread, which goes
+   back into the run queue.  This saves a wakeup of a waiting
+   thread by a lower-priority one the round trip of NEXT through
+   the run queue.  Must be called with interrupts off. */
+static void
+thread_handoff(struct thread *next)
+{
+    struct thread *cur = thread_current();
+
+    ASSERT(!intr_context());
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(next->status == THREAD_READY);
+
+    handoff_cnt++;
+    cur->status = THREAD_READY;
+    ready_queue_push(cur);
+    schedule_to(next);
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid(void)
@@ -791,7 +1344,7 @@ allocate_tid(void)
 static void
 update_priority(struct thread *t, void *aux)
 {
-    if (t == idle_thread)
+    if (t == idle_thread || is_periodic(t))
         return;
     int pri_max_term = int_to_fixed(PRI_MAX),
         recent_cpu_term = fixed_div_int(t->recent_cpu, 4),
@@ -801,41 +1354,364 @@ update_priority(struct thread *t, void *aux)
         new_priority = PRI_MAX;
     if (new_priority < PRI_MIN)
         new_priority = PRI_MIN;
-    t->priority = t->original_priority = new_priority;
+    t->original_priority = new_priority;
+    thread_change_priority(t, new_priority);
 
     struct thread *cur = running_thread();
-    if (t == cur && aux == 1)
-        if (!list_empty(&ready_list))
+    if (t == cur && aux == 1 && cur->priority < ready_queue_max_priority())
+        thread_yield();
+}
+
+/* Applies the once-per-second decays of recent_cpu that T has
+   missed, and moves T to the back of decay_list if it is there.
+   Returns true if T's recent_cpu changed. */
+static bool
+update_recent_cpu(struct thread *t)
+{
+    bool changed = t->decay_epoch != decay_epoch;
+
+    ASSERT(t != idle_thread);
+    ASSERT(decay_epoch - t->decay_epoch < DECAY_HISTORY);
+
+    while (t->decay_epoch != decay_epoch)
+    {
+        int coefficient = decay_coef[++t->decay_epoch % DECAY_HISTORY];
+        t->recent_cpu = fixed_plus_int(fixed_mul_fixed(coefficient, t->recent_cpu), t->nice);
+    }
+
+    if (t->decay_deferred)
+    {
+        list_remove(&t->decayelem);
+        list_push_back(&decay_list, &t->decayelem);
+    }
+    return changed;
+}
+
+/* Once-per-second update for the multi-level feedback queue
+   scheduler: updates load_avg and starts a new decay epoch.
+   Decays the running and ready threads right away, and just
+   enough blocked threads that none falls out of decay_coef's
+   history.  Because TIMER_FREQ is a multiple of TIME_SLICE,
+   this is also the end of a time slice, so the decayed threads'
+   priorities are recomputed here as well. */
+static void
+mlfqs_second(void)
+{
+    struct thread *cur = running_thread();
+    struct list_elem *e;
+    int load_avg_term;
+    int pri;
+
+    update_load_avg();
+    load_avg_term = fixed_mul_int(load_avg, 2);
+    decay_coef[++decay_epoch % DECAY_HISTORY] =
+        fixed_div_fixed(load_avg_term, fixed_plus_int(load_avg_term, 1));
+
+    if (cur != idle_thread)
+    {
+        update_recent_cpu(cur);
+        update_priority(cur, NULL);
+    }
+
+    /* A thread can move to a higher queue that is yet to be
+       visited, but then it is already up to date. */
+    for (pri = PRI_MIN; pri <= PRI_MAX; pri++)
+    {
+        struct list_elem *e = list_begin(&ready_queues[pri]);
+
+        while (e != list_end(&ready_queues[pri]))
         {
-            struct list_elem *max_e = list_max(&ready_list, less_priority, NULL);
+            struct thread *t = list_entry(e, struct thread, elem);
 
-            if (cur->priority < list_entry(max_e, struct thread, elem)->priority)
-                thread_yield();
+            e = list_next(e);
+            if (update_recent_cpu(t))
+                update_priority(t, NULL);
         }
+    }
+
+    /* Re-keys each waiter in the heap it waits in. */
+    for (e = list_begin(&waiter_list); e != list_end(&waiter_list); e = list_next(e))
+    {
+        struct thread *t = list_entry(e, struct thread, decayelem);
+
+        update_recent_cpu(t);
+        update_priority(t, NULL);
+    }
+
+    while (!list_empty(&decay_list))
+    {
+        struct thread *t = list_entry(list_front(&decay_list), struct thread, decayelem);
+
+        if (decay_epoch - t->decay_epoch < DECAY_HISTORY - 1)
+            break;
+        update_recent_cpu(t);
+        update_priority(t, NULL);
+    }
 }
 
-/* Updates recent cpu of T. */
+/* End-of-time-slice update for the multi-level feedback queue
+   scheduler: recomputes the priorities of the threads that ran
+   during the slice, the only ones whose recent_cpu changed. */
 static void
-update_recent_cpu(struct thread *t, void *aux UNUSED)
+mlfqs_slice(void)
 {
-    if (t == idle_thread)
-        return;
-    int load_avg_term = fixed_mul_int(load_avg, 2),
-        coefficient = fixed_div_fixed(load_avg_term, fixed_plus_int(load_avg_term, 1));
-    t->recent_cpu = fixed_plus_int(fixed_mul_fixed(coefficient, t->recent_cpu), t->nice);
+    int i;
+
+    for (i = 0; i < ran_cnt; i++)
+        update_priority(ran_threads[i], NULL);
+    ran_cnt = 0;
 }
 
 /* Updates load avg. */
 static void
 update_load_avg(void)
 {
-    int ready_threads = list_size(&ready_list);
+    int ready_threads = ready_cnt;
     if (thread_current() != idle_thread)
         ready_threads++;
     int load_avg_term = fixed_mul_int(load_avg, 59);
     load_avg = fixed_div_int(fixed_plus_int(load_avg_term, ready_threads), 60);
 }
 
+/* Orders threads in cfs_queue by virtual runtime. */
+static bool
+less_vruntime(const struct rb_elem *a_, const struct rb_elem *b_,
+              void *aux UNUSED)
+{
+    const struct thread *a = rb_entry(a_, struct thread, cfselem);
+    const struct thread *b = rb_entry(b_, struct thread, cfselem);
+
+    return a->vruntime < b->vruntime;
+}
+
+/* Per-tick accounting for the completely fair scheduler:
+   charges the tick to running thread T and asks for preemption
+   once T has used up its share of the scheduling latency. */
+static void
+cfs_tick(struct thread *t)
+{
+    struct thread *next;
+    int64_t least, ideal;
+
+    t->vruntime += NICE_0_WEIGHT * NICE_0_WEIGHT / t->weight;
+    if (rb_empty(&cfs_queue))
+    {
+        if (t->vruntime > min_vruntime)
+            min_vruntime = t->vruntime;
+        return;
+    }
+
+    next = rb_entry(rb_min(&cfs_queue), struct thread, cfselem);
+    least = t->vruntime < next->vruntime ? t->vruntime : next->vruntime;
+    if (least > min_vruntime)
+        min_vruntime = least;
+
+    /* T's share of the latency, in ticks. */
+    ideal = CFS_LATENCY * t->weight / (cfs_ready_weight + t->weight);
+    if (ideal < CFS_MIN_GRANULARITY)
+        ideal = CFS_MIN_GRANULARITY;
+
+    if (thread_ticks >= ideal)
+        intr_yield_on_return();
+    else if (thread_ticks >= CFS_MIN_GRANULARITY && t->vruntime - next->vruntime > ideal * NICE_0_WEIGHT)
+        intr_yield_on_return();
+}
+
+/* Sets the virtual runtime of T, which is about to become
+   runnable, relative to min_vruntime.  A new thread (INITIAL is
+   true) starts at min_vruntime, so it cannot monopolize the CPU.
+   A thread waking up keeps its vruntime, but one that slept for
+   a long time is credited at most half the latency, so it runs
+   soon without starving the others. */
+static void
+cfs_place(struct thread *t, bool initial)
+{
+    int64_t vruntime = min_vruntime;
+
+    if (!initial)
+    {
+        vruntime -= CFS_LATENCY * NICE_0_WEIGHT / 2;
+        if (t->vruntime > vruntime)
+            vruntime = t->vruntime;
+    }
+    t->vruntime = vruntime;
+}
+
+/* Returns true if thread T, which just became ready, should
+   preempt running thread CUR under the completely fair
+   scheduler, because T is far enough behind CUR in virtual
+   runtime. */
+static bool
+cfs_should_preempt(struct thread *cur, struct thread *t)
+{
+    return cur->vruntime - t->vruntime > CFS_WAKEUP_GRANULARITY * NICE_0_WEIGHT;
+}
+
 /* Offset of `stack' member within `struct thread'.
    Used by switch.S, which can't figure it out on its own. */
 uint32_t thread_stack_ofs = offsetof(struct thread, stack);
+
+/* Returns a page for a new thread, from the thread cache if it
+   has one or else from the page allocator, or a null pointer if
+   no page is available.  Only the struct thread at the bottom of
+   the page is cleared, by init_thread(), not the rest. */
+static struct thread *
+thread_page_get(void)
+{
+    struct thread *t = NULL;
+    enum intr_level old_level;
+
+    old_level = intr_disable();
+    if (thread_cache_cnt > 0)
+    {
+        t = thread_cache[--thread_cache_cnt];
+        thread_cache_hits++;
+    }
+    else
+        thread_cache_misses++;
+    intr_set_level(old_level);
+
+    if (t == NULL)
+        t = palloc_get_page(0);
+    return t;
+}
+
+/* Keeps the page of dead thread T in the thread cache, or frees
+   it if the cache is full.  Must be called with interrupts turned
+   off. */
+static void
+thread_page_put(struct thread *t)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (thread_cache_cnt < THREAD_CACHE_SIZE)
+        thread_cache[thread_cache_cnt++] = t;
+    else
+        palloc_free_page(t);
+}
+
+/* Returns true if T is a periodic thread. */
+static bool
+is_periodic(const struct thread *t)
+{
+    return t->edf.period != 0;
+}
+
+/* Returns true if T, which was just made ready, should preempt
+   running thread CUR.  A periodic thread preempts any other
+   thread with a later deadline, and no other thread preempts a
+   periodic one. */
+static bool
+thread_preempts(struct thread *t, struct thread *cur)
+{
+    if (is_periodic(t) || is_periodic(cur))
+        return is_periodic(t) && (!is_periodic(cur) || t->edf.deadline < cur->edf.deadline);
+    return thread_cfs ? cfs_should_preempt(cur, t) : t->priority > cur->priority;
+}
+
+/* Returns true if T, which is ready but not in the run queue,
+   beats every thread in the run queue.  Under the completely
+   fair scheduler, only a periodic thread can be known to. */
+static bool
+thread_runs_next(struct thread *t)
+{
+    if (is_periodic(t))
+        return heap_empty(&edf_queue)
+               || t->edf.deadline < heap_entry(heap_top(&edf_queue), struct thread, edf.elem)->edf.deadline;
+    return !thread_cfs && heap_empty(&edf_queue) && t->priority >= ready_queue_max_priority();
+}
+
+/* Orders periodic threads in edf_queue so that the one with the
+   earliest deadline is at the top. */
+static bool
+less_deadline(const struct heap_elem *a_, const struct heap_elem *b_, void *aux UNUSED)
+{
+    const struct thread *a = heap_entry(a_, struct thread, edf.elem);
+    const struct thread *b = heap_entry(b_, struct thread, edf.elem);
+
+    return a->edf.deadline > b->edf.deadline;
+}
+
+/* Body of a periodic thread: runs one job per release. */
+static void
+periodic_main(void *aux UNUSED)
+{
+    struct thread *cur = thread_current();
+    struct periodic *p = &cur->edf;
+    enum intr_level old_level;
+
+    for (;;)
+    {
+        old_level = intr_disable();
+        if (p->fresh)
+        {
+            uint64_t jitter = rdtsc() - p->release_tsc;
+
+            p->stats.jitter_sum += jitter;
+            edf_stats.jitter_sum += jitter;
+            if (jitter > p->stats.jitter_max)
+                p->stats.jitter_max = jitter;
+            if (jitter > edf_stats.jitter_max)
+                edf_stats.jitter_max = jitter;
+            p->fresh = false;
+        }
+        p->job_release = p->release;
+        intr_set_level(old_level);
+
+        p->function(p->aux);
+
+        /* If the job ran past its deadline, the next one is
+           already released, so start it right away. */
+        old_level = intr_disable();
+        p->stats.jobs++;
+        edf_stats.jobs++;
+        if (p->release == p->job_release)
+        {
+            p->pending = false;
+            p->parked = true;
+            thread_block_for(WAIT_PERIOD);
+        }
+        intr_set_level(old_level);
+    }
+}
+
+/* Timeout function for a periodic thread's next release.  Starts
+   a new period for thread T: counts a miss if the current job is
+   not done, refills the budget, moves the deadline, and wakes T
+   if it waits for the release.  Runs in the timer interrupt. */
+static void
+periodic_release(void *t_)
+{
+    struct thread *t = t_;
+    struct periodic *p = &t->edf;
+
+    p->release = p->deadline;
+    p->deadline = p->release + p->period;
+    p->used = 0;
+    p->release_tsc = rdtsc();
+    if (p->pending)
+    {
+        p->stats.misses++;
+        edf_stats.misses++;
+    }
+    p->pending = true;
+    timeout_arm(&p->timeout, p->deadline);
+
+    if (p->parked)
+    {
+        p->parked = false;
+        p->fresh = true;
+        thread_unblock(t);
+    }
+    else if (p->throttled)
+    {
+        p->throttled = false;
+        if (t->status == THREAD_BLOCKED)
+            thread_unblock(t);
+    }
+    else if (t->status == THREAD_READY)
+        heap_update(&edf_queue, &p->elem);
+    else if (t->status == THREAD_RUNNING && !heap_empty(&edf_queue)
+             && thread_preempts(heap_entry(heap_top(&edf_queue), struct thread, edf.elem), t))
+        intr_yield_on_return();
+}
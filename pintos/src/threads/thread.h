@@ -3,7 +3,10 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rbtree.h>
 #include <stdint.h>
+#include "threads/schedstat.h"
+#include "devices/timer.h"
 #include "vm/page.h"
 #include "threads/synch.h"
 #include "filesys/file.h"
@@ -29,6 +32,11 @@ typedef int mapid_t;
 #define PRI_DEFAULT 31 /* Default priority. */
 #define PRI_MAX 63     /* Highest priority. */
 
+/* Thread nice values. */
+#define NICE_MIN -20    /* Nicest to others. */
+#define NICE_DEFAULT 0  /* Default nice value. */
+#define NICE_MAX 20     /* Least nice to others. */
+
 struct mmap_table_entry {
    mapid_t mapid;
    void* vaddr;
@@ -86,12 +94,47 @@ struct mmap_table_entry {
    the `magic' member of the running thread's `struct thread' is
    set to THREAD_MAGIC.  Stack overflow will normally change this
    value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+/* Deadline and budget statistics of a periodic thread.  Times
+   are in time-stamp counter cycles. */
+struct periodic_stats
+{
+    long long jobs;      /* # of jobs completed. */
+    long long misses;    /* # of deadlines missed. */
+    long long throttles; /* # of times budget ran out. */
+    uint64_t jitter_sum; /* Total delay from release to job start. */
+    uint64_t jitter_max; /* Greatest such delay. */
+};
+
+/* Scheduling state of a periodic thread, created by
+   thread_create_periodic().  Such a thread runs one job per
+   period and is scheduled earliest deadline first, ahead of all
+   other threads.  The deadline of each job is the next release. */
+struct periodic
+{
+    int64_t period;           /* Ticks between releases, or 0. */
+    int64_t budget;           /* Ticks of CPU time per period. */
+    int64_t release;          /* Tick of latest release. */
+    int64_t deadline;         /* Tick of next release. */
+    int64_t job_release;      /* Release when current job started. */
+    int64_t used;             /* Ticks run since latest release. */
+    bool pending;             /* Job released and not completed? */
+    bool parked;              /* Blocked until next release? */
+    bool throttled;           /* Out of budget until next release? */
+    bool fresh;               /* Released, job not yet started? */
+    uint64_t release_tsc;     /* Time-stamp counter at release. */
+    void (*function)(void *); /* Runs one job. */
+    void *aux;                /* Passed to FUNCTION. */
+    struct timeout timeout;   /* Fires at next release. */
+    struct heap_elem elem;    /* Element in EDF run queue. */
+    struct periodic_stats stats;
+};
+
+/* The `elem' member is an element in the run queue (thread.c).
+   A thread waiting on a semaphore is instead in the semaphore's
+   waiters heap through `waitelem' (synch.c).  Because a waiting
+   thread's priority can change through donation, `wait_queue'
+   and `wait_elem' record the heap that orders it, so that
+   thread_change_priority() can re-key it there. */
 struct thread
 {
     /* Owned by thread.c. */
@@ -105,18 +148,31 @@ struct thread
     /* Shared between thread.c and synch.c. */
     struct list_elem elem; /* List element. */
 
-    /* Owned by devices/timer.c. */
-    int64_t wake_ticks; /* Ticks to wake up. */
-
     /* Shared between thread.c and synch.c. */
-    int original_priority;   /* Original priority before donation. */
-    struct list donators;    /* List of donators. */
-    struct list_elem doelem; /* List element for donators list. */
-    struct thread *donee;    /* Thread that is given priority. */
+    int original_priority;      /* Original priority before donation. */
+    struct heap held_locks;     /* Locks held, by donated priority. */
+    struct lock *wait_lock;     /* Lock being waited for, or null. */
+    struct rwlock *wait_rwlock; /* Reader-writer lock being waited for. */
+    struct rwlock_reader reads[RWLOCK_READS_MAX]; /* Read holds. */
+    struct heap_elem waitelem;  /* Heap element for semaphore waiters. */
+    struct heap *wait_queue;    /* Wait queue to re-key on priority change. */
+    struct heap_elem *wait_elem; /* This thread's element in wait_queue. */
+    struct semaphore *cancel_sema; /* In sema_down_cancelable() on this. */
+    bool canceled;              /* Cancelable waits give up? */
 
     /* Owned by thread.c. */
-    int nice;       /* Figure that indicates how nice to others. */
-    int recent_cpu; /* Weighted average amount of received CPU time. */
+    int nice;                   /* Figure that indicates how nice to others. */
+    int recent_cpu;             /* Weighted average amount of received CPU time. */
+    int decay_epoch;            /* # of recent_cpu decays applied. */
+    bool decay_deferred;        /* In decay list? */
+    bool decay_waiting;         /* In waiter list? */
+    struct list_elem decayelem; /* List element for decay list. */
+    int weight;                 /* CFS weight, from nice. */
+    int64_t vruntime;           /* CFS virtual runtime. */
+    struct rb_elem cfselem;     /* Tree element for CFS run queue. */
+    struct schedstat sched;     /* Scheduler statistics. */
+    struct periodic edf;        /* Periodic thread state. */
+    void *fpu;                  /* FPU save area, or null. */
 
 #ifdef USERPROG
     /* Shared between userprog/process.c and userprog/syscall.c. */
@@ -126,11 +182,22 @@ struct thread
     struct list fdt;           /* List of file descriptor entries. */
     int next_fd;               /* File descriptor for next file. */
     struct file *running_file; /* Currently running file. */
+
+    /* Threads of a process share the state above through the
+       process's main thread, its leader. */
+    struct thread *leader;      /* Main thread of the process. */
+    struct uthread *uthread;    /* Own record, if not the leader. */
+    struct list uthreads;       /* Leader only: unjoined threads. */
+    struct lock uthread_lock;   /* Leader only: protects uthreads. */
+    struct lock children_lock;  /* Leader only: protects children. */
+    unsigned uthread_slots;     /* Leader only: user stacks in use. */
+    bool exiting;               /* Leader only: process is exiting. */
 #endif
 
 #ifdef VM
    struct hash supplemental_page_table;
    struct lock supplemental_page_table_lock;
+   struct lock fault_lock;      /* Serializes the process's page faults. */
    struct list mmap_table;
    mapid_t max_mapid;
 #endif
@@ -144,16 +211,25 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-o cfs". */
+extern bool thread_cfs;
+
 void thread_init(void);
 void thread_start(void);
 
 void thread_tick(void);
+void thread_skip_ticks(int cnt);
 void thread_print_stats(void);
 
 typedef void thread_func(void *aux);
 tid_t thread_create(const char *name, int priority, thread_func *, void *);
+tid_t thread_create_periodic(const char *name, int64_t period, int64_t budget,
+                             thread_func *, void *);
+void thread_get_periodic_stats(struct periodic_stats *);
 
 void thread_block(void);
+void thread_block_for(enum wait_reason);
 void thread_unblock(struct thread *);
 
 struct thread *thread_current(void);
@@ -169,17 +245,15 @@ void thread_foreach(thread_action_func *, void *);
 
 int thread_get_priority(void);
 void thread_set_priority(int);
+void thread_change_priority(struct thread *, int);
+int thread_effective_priority(struct thread *);
+void thread_set_wait_queue(struct thread *, struct heap *, struct heap_elem *);
 
 int thread_get_nice(void);
 void thread_set_nice(int);
 int thread_get_recent_cpu(void);
 int thread_get_load_avg(void);
 
-struct list *get_sleep_list(void);
-struct list *thread_get_donators(void);
-struct thread *thread_get_donee(void);
-void thread_set_donee(struct thread *);
-
 #ifdef USERPROG
 uint32_t *thread_get_pagedir(void);
 void thread_set_pagedir(uint32_t *);
@@ -192,6 +266,4 @@ struct file *thread_get_running_file(void);
 void thread_set_running_file(struct file *);
 #endif
 
-list_less_func less_priority;
-
 #endif /* threads/thread.h */
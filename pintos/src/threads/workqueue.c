@@ -0,0 +1,397 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "threads/tsc.h"
+
+/* Work queues.
+
+   Work can be queued from any context, including interrupt
+   handlers and timeouts, so each queue is protected by turning
+   interrupts off rather than by a lock.  Each queued work ups
+   the queue's `avail' semaphore once, which wakes up one idle
+   worker.  Cancelling queued work takes that count back if no
+   worker has taken it yet; otherwise the worker that wakes up
+   finds nothing to do and goes back to waiting.
+
+   Worker threads never exit, so queues must never be
+   destroyed. */
+
+struct workqueue system_wq;
+
+/* All queues, for statistics.  Initialized statically so that
+   statistics can be printed on a panic early in boot. */
+static struct list all_queues = LIST_INITIALIZER(all_queues);
+
+/* A thread waiting in workqueue_flush(). */
+struct flusher
+{
+    struct semaphore done;  /* Upped when the queue is idle. */
+    struct list_elem elem;  /* Element in `flushers' list. */
+};
+
+static thread_func worker_main NO_RETURN;
+static timeout_func delayed_work_timeout;
+static heap_less_func less_work_fifo;
+static heap_less_func less_work_priority;
+static bool queue_locked(struct workqueue *, struct work *);
+static bool cancel_locked(struct work *);
+static void wake_flushers(struct workqueue *);
+
+/* Initializes the work queue subsystem and starts the worker
+   of the system queue.  Must be called after thread_start(). */
+void workqueue_start(void)
+{
+    workqueue_init(&system_wq, "events", 1, PRI_DEFAULT, false);
+}
+
+/* Initializes WQ as a queue named NAME, served by WORKER_CNT
+   worker threads of the given PRIORITY.  If PRIORITIZED is
+   true, work of higher priority runs first; otherwise work runs
+   in the order it was queued. */
+void workqueue_init(struct workqueue *wq, const char *name, int worker_cnt,
+                    int priority, bool prioritized)
+{
+    enum intr_level old_level;
+    int i;
+
+    ASSERT(wq != NULL);
+    ASSERT(name != NULL);
+    ASSERT(worker_cnt > 0 && worker_cnt <= WORKQUEUE_WORKERS_MAX);
+    ASSERT(priority >= PRI_MIN && priority <= PRI_MAX);
+
+    strlcpy(wq->name, name, sizeof wq->name);
+    heap_init(&wq->queue, prioritized ? less_work_priority : less_work_fifo,
+              NULL);
+    sema_init(&wq->avail, 0);
+    wq->busy = 0;
+    list_init(&wq->flushers);
+    wq->queued_cnt = wq->done_cnt = wq->cancel_cnt = 0;
+    wq->depth_sum = 0;
+    wq->depth_max = 0;
+    wq->latency_sum = wq->latency_max = 0;
+
+    old_level = intr_disable();
+    list_push_back(&all_queues, &wq->elem);
+    intr_set_level(old_level);
+
+    for (i = 0; i < worker_cnt; i++)
+        if (thread_create(wq->name, priority, worker_main, wq) == TID_ERROR)
+            PANIC("can't start worker for %s", wq->name);
+}
+
+/* Queues WORK on WQ.  Returns true if successful, false if WORK
+   was already queued.  May be called from an interrupt
+   handler. */
+bool workqueue_queue(struct workqueue *wq, struct work *work)
+{
+    enum intr_level old_level;
+    bool queued;
+
+    ASSERT(wq != NULL);
+    ASSERT(work != NULL);
+
+    old_level = intr_disable();
+    queued = queue_locked(wq, work);
+    intr_set_level(old_level);
+
+    return queued;
+}
+
+/* Queues DW's work on WQ once TICKS timer ticks have passed, or
+   right away if TICKS is not positive.  Returns true if
+   successful, false if DW was already waiting for its timeout
+   or queued.  May be called from an interrupt handler. */
+bool workqueue_queue_delayed(struct workqueue *wq, struct delayed_work *dw,
+                             int64_t ticks)
+{
+    enum intr_level old_level;
+    bool queued;
+
+    ASSERT(wq != NULL);
+    ASSERT(dw != NULL);
+
+    old_level = intr_disable();
+    if (dw->timeout.pending || dw->work.pending)
+        queued = false;
+    else if (ticks <= 0)
+        queued = queue_locked(wq, &dw->work);
+    else
+    {
+        dw->work.wq = wq;
+        timeout_arm(&dw->timeout, timer_ticks() + ticks);
+        queued = true;
+    }
+    intr_set_level(old_level);
+
+    return queued;
+}
+
+/* Waits until WQ has no queued work and none of its workers is
+   running a function.  Work that keeps being queued can delay
+   this indefinitely.  Must not be called by a worker of WQ. */
+void workqueue_flush(struct workqueue *wq)
+{
+    enum intr_level old_level;
+    struct flusher flusher;
+    bool idle;
+
+    ASSERT(!intr_context());
+
+    old_level = intr_disable();
+    idle = wq->busy == 0 && heap_empty(&wq->queue);
+    if (!idle)
+    {
+        sema_init(&flusher.done, 0);
+        list_push_back(&wq->flushers, &flusher.elem);
+    }
+    intr_set_level(old_level);
+
+    if (!idle)
+        sema_down(&flusher.done);
+}
+
+/* Prints statistics for every work queue that has had work. */
+void workqueue_print_stats(void)
+{
+    struct list_elem *e;
+
+    for (e = list_begin(&all_queues); e != list_end(&all_queues);
+         e = list_next(e))
+    {
+        struct workqueue *wq = list_entry(e, struct workqueue, elem);
+
+        if (wq->queued_cnt == 0)
+            continue;
+        printf("Workqueue %s: %lld queued, %lld done, %lld cancelled, "
+               "depth %lld avg/%zu max, latency %llu avg/%llu max cycles\n",
+               wq->name, wq->queued_cnt, wq->done_cnt, wq->cancel_cnt,
+               wq->depth_sum / wq->queued_cnt, wq->depth_max,
+               (unsigned long long)(wq->latency_sum / wq->queued_cnt),
+               (unsigned long long)wq->latency_max);
+    }
+}
+
+/* Initializes WORK to call FUNC(AUX), at PRI_DEFAULT. */
+void work_init(struct work *work, work_func *func, void *aux)
+{
+    ASSERT(work != NULL);
+    ASSERT(func != NULL);
+
+    work->func = func;
+    work->aux = aux;
+    work->priority = PRI_DEFAULT;
+    work->wq = NULL;
+    work->pending = false;
+}
+
+/* Sets the priority of WORK in prioritized queues to PRIORITY.
+   WORK must not be queued. */
+void work_set_priority(struct work *work, int priority)
+{
+    ASSERT(!work->pending);
+    ASSERT(priority >= PRI_MIN && priority <= PRI_MAX);
+
+    work->priority = priority;
+}
+
+/* Removes WORK from its queue.  Returns true if it was queued,
+   false if it was not, or a worker has already started calling
+   its function, which this function does not wait for.  May be
+   called from an interrupt handler. */
+bool work_cancel(struct work *work)
+{
+    enum intr_level old_level;
+    bool cancelled;
+
+    old_level = intr_disable();
+    cancelled = cancel_locked(work);
+    intr_set_level(old_level);
+
+    return cancelled;
+}
+
+/* Initializes DW to call FUNC(AUX) after a delay. */
+void delayed_work_init(struct delayed_work *dw, work_func *func, void *aux)
+{
+    ASSERT(dw != NULL);
+
+    work_init(&dw->work, func, aux);
+    timeout_init(&dw->timeout, delayed_work_timeout, dw);
+}
+
+/* Stops DW from running, whether it is still waiting for its
+   timeout or already queued.  Returns true if it was stopped,
+   false if it was neither.  May be called from an interrupt
+   handler. */
+bool delayed_work_cancel(struct delayed_work *dw)
+{
+    enum intr_level old_level;
+    bool cancelled;
+
+    old_level = intr_disable();
+    cancelled = timeout_cancel(&dw->timeout) || cancel_locked(&dw->work);
+    intr_set_level(old_level);
+
+    return cancelled;
+}
+
+/* If DW is waiting for its timeout, queues it right away.  Then
+   waits for its queue to become idle, so that DW's function has
+   returned. */
+void delayed_work_flush(struct delayed_work *dw)
+{
+    enum intr_level old_level;
+    struct workqueue *wq;
+
+    old_level = intr_disable();
+    wq = dw->work.wq;
+    if (timeout_cancel(&dw->timeout))
+        queue_locked(wq, &dw->work);
+    intr_set_level(old_level);
+
+    if (wq != NULL)
+        workqueue_flush(wq);
+}
+
+/* Worker thread for queue WQ_: calls the function of each
+   work as it reaches the head of the queue. */
+static void
+worker_main(void *wq_)
+{
+    struct workqueue *wq = wq_;
+
+    for (;;)
+    {
+        enum intr_level old_level;
+        struct work *work;
+        work_func *func;
+        void *aux;
+        uint64_t latency;
+
+        sema_down(&wq->avail);
+
+        old_level = intr_disable();
+        if (heap_empty(&wq->queue))
+        {
+            /* Work was cancelled after upping `avail'. */
+            intr_set_level(old_level);
+            continue;
+        }
+        work = heap_entry(heap_pop(&wq->queue), struct work, elem);
+        work->pending = false;
+        latency = rdtsc() - work->queued;
+        wq->latency_sum += latency;
+        if (latency > wq->latency_max)
+            wq->latency_max = latency;
+        wq->busy++;
+
+        /* WORK may be queued again, or freed, once FUNC starts. */
+        func = work->func;
+        aux = work->aux;
+        intr_set_level(old_level);
+
+        func(aux);
+
+        old_level = intr_disable();
+        wq->busy--;
+        wq->done_cnt++;
+        wake_flushers(wq);
+        intr_set_level(old_level);
+    }
+}
+
+/* Queues the delayed work DW_ when its timeout expires. */
+static void
+delayed_work_timeout(void *dw_)
+{
+    struct delayed_work *dw = dw_;
+
+    queue_locked(dw->work.wq, &dw->work);
+}
+
+/* Queues WORK on WQ, unless it is already queued.  Returns
+   true if successful.  Interrupts must be off. */
+static bool
+queue_locked(struct workqueue *wq, struct work *work)
+{
+    size_t depth;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (work->pending)
+        return false;
+
+    work->wq = wq;
+    work->pending = true;
+    work->queued = rdtsc();
+    heap_push(&wq->queue, &work->elem);
+
+    depth = heap_size(&wq->queue);
+    wq->queued_cnt++;
+    wq->depth_sum += depth;
+    if (depth > wq->depth_max)
+        wq->depth_max = depth;
+
+    sema_up(&wq->avail);
+    return true;
+}
+
+/* Removes WORK from its queue if it is queued, and returns
+   true if so.  Interrupts must be off. */
+static bool
+cancel_locked(struct work *work)
+{
+    struct workqueue *wq = work->wq;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (!work->pending)
+        return false;
+
+    heap_remove(&wq->queue, &work->elem);
+    work->pending = false;
+    wq->cancel_cnt++;
+    sema_try_down(&wq->avail);
+    wake_flushers(wq);
+    return true;
+}
+
+/* Wakes up the threads waiting for WQ to become idle, if it
+   is.  Interrupts must be off. */
+static void
+wake_flushers(struct workqueue *wq)
+{
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (wq->busy != 0 || !heap_empty(&wq->queue))
+        return;
+    while (!list_empty(&wq->flushers))
+    {
+        struct flusher *f = list_entry(list_pop_front(&wq->flushers),
+                                       struct flusher, elem);
+        sema_up(&f->done);
+    }
+}
+
+/* Orders work in a FIFO queue: all work compares equal, so the
+   heap gives it back in the order it was queued. */
+static bool
+less_work_fifo(const struct heap_elem *a UNUSED,
+               const struct heap_elem *b UNUSED, void *aux UNUSED)
+{
+    return false;
+}
+
+/* Orders work in a prioritized queue by priority. */
+static bool
+less_work_priority(const struct heap_elem *a_, const struct heap_elem *b_,
+                   void *aux UNUSED)
+{
+    const struct work *a = heap_entry(a_, struct work, elem);
+    const struct work *b = heap_entry(b_, struct work, elem);
+
+    return a->priority < b->priority;
+}
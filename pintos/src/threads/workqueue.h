@@ -0,0 +1,81 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <heap.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "devices/timer.h"
+#include "threads/synch.h"
+
+/* Deferred work, called by a worker thread as FUNC(AUX). */
+typedef void work_func(void *aux);
+
+/* A piece of deferred work.  It may be queued again once a
+   worker has started calling its function, but not before. */
+struct work
+{
+    work_func *func;        /* Function to call. */
+    void *aux;              /* Auxiliary data for FUNC. */
+    int priority;           /* Priority in a prioritized queue. */
+    struct workqueue *wq;   /* Queue it is or was last queued on. */
+    bool pending;           /* Queued and not yet started? */
+    uint64_t queued;        /* TSC when queued. */
+    struct heap_elem elem;  /* Element in queue. */
+};
+
+/* Work that is queued when a timeout expires. */
+struct delayed_work
+{
+    struct work work;       /* The work. */
+    struct timeout timeout; /* Queues WORK when it expires. */
+};
+
+/* Maximum number of worker threads per queue. */
+#define WORKQUEUE_WORKERS_MAX 8
+
+/* A queue of work served by a fixed pool of worker threads.
+   A FIFO queue runs work in the order it was queued; a
+   prioritized queue runs the work of highest priority first,
+   and work of equal priority in the order it was queued. */
+struct workqueue
+{
+    char name[16];          /* Name, for worker threads and stats. */
+    struct heap queue;      /* Queued work. */
+    struct semaphore avail; /* Upped once per queued work. */
+    int busy;               /* Workers running a function. */
+    struct list flushers;   /* Threads in workqueue_flush(). */
+    struct list_elem elem;  /* Element in list of all queues. */
+
+    /* Statistics.  Latency is the time from queuing work to
+       calling its function, in TSC cycles. */
+    long long queued_cnt;   /* # of times work was queued. */
+    long long done_cnt;     /* # of functions that returned. */
+    long long cancel_cnt;   /* # of queued work cancelled. */
+    long long depth_sum;    /* Sum of depths as work was queued. */
+    size_t depth_max;       /* Most work queued at once. */
+    uint64_t latency_sum;   /* Total latency. */
+    uint64_t latency_max;   /* Longest latency. */
+};
+
+/* Queue for work that needs no queue of its own. */
+extern struct workqueue system_wq;
+
+void workqueue_start(void);
+void workqueue_init(struct workqueue *, const char *name, int worker_cnt,
+                    int priority, bool prioritized);
+bool workqueue_queue(struct workqueue *, struct work *);
+bool workqueue_queue_delayed(struct workqueue *, struct delayed_work *,
+                             int64_t ticks);
+void workqueue_flush(struct workqueue *);
+void workqueue_print_stats(void);
+
+void work_init(struct work *, work_func *, void *aux);
+void work_set_priority(struct work *, int priority);
+bool work_cancel(struct work *);
+
+void delayed_work_init(struct delayed_work *, work_func *, void *aux);
+bool delayed_work_cancel(struct delayed_work *);
+void delayed_work_flush(struct delayed_work *);
+
+#endif /* threads/workqueue.h */
@@ -6,6 +6,8 @@
 #include "userprog/syscall.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
 #include "vm/page.h"
 #include "vm/swap.h"
 
@@ -48,8 +50,7 @@ void exception_init(void)
     intr_register_int(0, 0, INTR_ON, kill, "#DE Divide Error");
     intr_register_int(1, 0, INTR_ON, kill, "#DB Debug Exception");
     intr_register_int(6, 0, INTR_ON, kill, "#UD Invalid Opcode Exception");
-    intr_register_int(7, 0, INTR_ON, kill,
-                      "#NM Device Not Available Exception");
+    /* #NM is handled by threads/fpu.c. */
     intr_register_int(11, 0, INTR_ON, kill, "#NP Segment Not Present");
     intr_register_int(12, 0, INTR_ON, kill, "#SS Stack Fault Exception");
     intr_register_int(13, 0, INTR_ON, kill, "#GP General Protection Exception");
@@ -129,7 +130,8 @@ page_fault(struct intr_frame *f)
     bool user;        /* True: access by user, false: access by kernel. */
     void *fault_addr; /* Fault address. */
     struct supplemental_page_table_entry* spte;
-    struct thread* t = thread_current ();
+    struct thread* t = thread_current ()->leader;
+    void* upage;
 
     /* Obtain faulting address, the virtual address that was
      accessed to cause the fault.  It may point to code or to
@@ -153,6 +155,11 @@ page_fault(struct intr_frame *f)
     write = (f->error_code & PF_W) != 0;
     user = (f->error_code & PF_U) != 0;
 
+    /* Another thread has exited the process. */
+    if (user && t->exiting) {
+        thread_exit ();
+    }
+
     /* If page fault occurs in user mode, terminates the current
      process. */
     if (!not_present || is_kernel_vaddr (fault_addr)) {
@@ -162,16 +169,32 @@ page_fault(struct intr_frame *f)
         syscall_exit (-1);
     }
 
-    spte = find_spte (t, pg_round_down (fault_addr));
+    /* Sibling threads may fault on the same page at once.  The
+       first one brings it in; the others find it present. */
+    upage = pg_round_down (fault_addr);
+    lock_acquire (&t->fault_lock);
+    if (pagedir_get_page (t->pagedir, upage) != NULL) {
+        lock_release (&t->fault_lock);
+        return;
+    }
+
+    spte = find_spte (t, upage);
 
     if (!spte) {
-        /* stack growth */
-        if (((f->esp - fault_addr) <= 32) &&         /* Maximum PUSH is 32 bytes. */
-            (PHYS_BASE - 0x800000 <= fault_addr)) {  /* Is fault_addr in the possible stack area? */
-            grow_stack (fault_addr);
+        /* stack growth, confined to the faulting thread's own
+           stack slot so that one thread cannot run into another's. */
+        struct uthread *ut = thread_current ()->uthread;
+        uint8_t *stack_top = (uint8_t *) PHYS_BASE
+                             - (ut != NULL ? ut->slot : 0) * UTHREAD_STACK_SIZE;
+        if (((f->esp - fault_addr) <= 32) &&                             /* Maximum PUSH is 32 bytes. */
+            (stack_top - UTHREAD_STACK_SIZE <= (uint8_t *) fault_addr) &&  /* Is fault_addr in this thread's stack slot? */
+            ((uint8_t *) fault_addr < stack_top) &&
+            grow_stack (fault_addr)) {
+            lock_release (&t->fault_lock);
             return;
         }
-        else if (lock_held_by_current_thread (syscall_get_filesys_lock ())) {
+        lock_release (&t->fault_lock);
+        if (lock_held_by_current_thread (syscall_get_filesys_lock ())) {
             lock_release (syscall_get_filesys_lock ());
             syscall_exit (-1);
         }
@@ -182,9 +205,11 @@ page_fault(struct intr_frame *f)
 
     if (spte->status == 0 || spte->status == 2) {
         load_file_page (spte);
+        lock_release (&t->fault_lock);
         return;
     }
     else {
+        lock_release (&t->fault_lock);
         syscall_exit (-1);
     }
 
@@ -15,6 +15,7 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
@@ -22,7 +23,17 @@
 #include "vm/page.h"
 #include "vm/swap.h"
 
+struct lock vm_destroy_lock;
+
 static thread_func start_process NO_RETURN;
+static thread_func start_uthread NO_RETURN;
+static bool setup_uthread_stack(void *upage);
+static void wait_uthreads(struct thread *leader);
+static void exit_uthread(void);
+static thread_action_func cancel_waits;
+static struct process *get_child(pid_t);
+static void remove_child(struct process *);
+static bool install_page(void *upage, void *kpage, bool writable);
 static bool load(const char *cmdline, void (**eip)(void), void **esp);
 
 static void parse_line(const char *line, int *argc, char **argv);
@@ -31,7 +42,8 @@ static void push_arguments(int argc, char **argv, void **esp);
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
    before process_execute() returns.  Returns the new process's
-   thread id, or TID_ERROR if the thread cannot be created. */
+   thread id, or TID_ERROR if the thread cannot be created or
+   the program cannot be loaded. */
 tid_t process_execute(const char *file_name)
 {
     char *fn_copy1, *fn_copy2, *thread_name, *save_ptr;
@@ -54,10 +66,11 @@ tid_t process_execute(const char *file_name)
     if (!pcb)
         return TID_ERROR;
     pcb->file_name = fn_copy1;
-    pcb->parent = thread_current();
+    pcb->parent = thread_current()->leader;
     pcb->is_loaded = false;
     sema_init(&pcb->load_sema, 0);
     pcb->is_exited = false;
+    pcb->is_waited = false;
     sema_init(&pcb->exit_sema, 0);
     pcb->exit_status = -1;
 
@@ -75,7 +88,15 @@ tid_t process_execute(const char *file_name)
      successfully load its program, push it into children list. */
     sema_down(&pcb->load_sema);
     if (pcb->pid != PID_ERROR)
-        list_push_back(thread_get_children(), &pcb->childelem);
+    {
+        struct thread *leader = thread_current()->leader;
+
+        lock_acquire(&leader->children_lock);
+        list_push_back(&leader->children, &pcb->childelem);
+        lock_release(&leader->children_lock);
+    }
+    else
+        tid = TID_ERROR;
 
 done:
     palloc_free_page(fn_copy2);
@@ -139,18 +160,33 @@ start_process(void *pcb_)
    immediately, without waiting. */
 int process_wait(tid_t child_tid)
 {
-    struct process *child = process_get_child(child_tid);
+    struct thread *leader = thread_current()->leader;
+    struct process *child;
     int exit_status;
 
     /* If CHILD is not the current process's child or is already
-     retrieved by the current process, return -1. */
+     retrieved or being waited for by a thread of the current
+     process, return -1.  Otherwise claim it, so that no other
+     thread waits for it too. */
+    lock_acquire(&leader->children_lock);
+    child = get_child(child_tid);
+    if (child && child->is_waited)
+        child = NULL;
+    if (child)
+        child->is_waited = true;
+    lock_release(&leader->children_lock);
     if (!child)
         return -1;
 
-    /* Wait until CHILD exits, and retrieve it. */
-    sema_down(&child->exit_sema);
+    /* Wait until CHILD exits, and retrieve it.  Give up if another
+     thread exits the current process meanwhile; CHILD is then
+     removed along with the others. */
+    if (!sema_down_cancelable(&child->exit_sema))
+        return -1;
     exit_status = child->exit_status;
-    process_remove_child(child);
+    lock_acquire(&leader->children_lock);
+    remove_child(child);
+    lock_release(&leader->children_lock);
 
     return exit_status;
 }
@@ -165,14 +201,28 @@ void process_exit(void)
     uint32_t *pd;
     struct mmap_table_entry* mte;
     struct list_elem *e;
-    int max_fd = thread_get_next_fd(), i;
+    int max_fd, i;
+
+    /* Everything below is shared with the other threads of the
+     process, so only the main thread frees it, once they have all
+     exited. */
+    if (cur->leader != cur)
+    {
+        exit_uthread();
+        return;
+    }
+    cur->exiting = true;
+    wait_uthreads(cur);
 
     /* Set exit flag, remove all of the current process's exited children,
      close all of its files, and notify its parent of its termination.
      Finally, free its page if it is orphaned. */
     pcb->is_exited = true;
+    lock_acquire(&cur->children_lock);
     for (e = list_begin(children); e != list_end(children); e = list_next(e))
-        process_remove_child(list_entry(e, struct process, childelem));
+        remove_child(list_entry(e, struct process, childelem));
+    lock_release(&cur->children_lock);
+    max_fd = thread_get_next_fd();
     for (i = 2; i < max_fd; i++)
         syscall_close(i);
     if (pcb && !pcb->parent)
@@ -213,6 +263,246 @@ void process_exit(void)
     }
 }
 
+/* Starts a new thread in the current process, which calls
+   EIP(FUNC, AUX) in user mode on a user stack of its own.
+   Returns the new thread's id, or TID_ERROR if the process
+   already has UTHREAD_MAX threads, is exiting, or the thread
+   cannot be created. */
+tid_t process_thread_create(void *eip, void *func, void *aux)
+{
+    struct thread *leader = thread_current()->leader;
+    struct uthread *ut;
+    tid_t tid = TID_ERROR;
+    int slot;
+
+    ut = malloc(sizeof *ut);
+    if (!ut)
+        return TID_ERROR;
+    ut->leader = leader;
+    ut->eip = eip;
+    ut->func = func;
+    ut->aux = aux;
+    sema_init(&ut->exit_sema, 0);
+
+    /* Hold the lock until UT is in the list, so that the new
+     thread cannot exit before then. */
+    lock_acquire(&leader->uthread_lock);
+    for (slot = 1; slot < UTHREAD_MAX; slot++)
+        if (!(leader->uthread_slots & (1u << slot)))
+            break;
+    if (!leader->exiting && slot < UTHREAD_MAX)
+    {
+        ut->slot = slot;
+        tid = ut->tid = thread_create(thread_name(), PRI_DEFAULT,
+                                      start_uthread, ut);
+        if (tid != TID_ERROR)
+        {
+            leader->uthread_slots |= 1u << slot;
+            list_push_back(&leader->uthreads, &ut->elem);
+        }
+    }
+    lock_release(&leader->uthread_lock);
+
+    if (tid == TID_ERROR)
+        free(ut);
+    return tid;
+}
+
+/* Waits for thread TID of the current process to exit and
+   returns TID.  Returns TID_ERROR immediately if TID is the
+   current thread, the process's main thread, not a thread of
+   the process, or has already been joined. */
+tid_t process_thread_join(tid_t tid)
+{
+    struct thread *cur = thread_current();
+    struct thread *leader = cur->leader;
+    struct uthread *ut = NULL;
+    struct list_elem *e;
+
+    lock_acquire(&leader->uthread_lock);
+    for (e = list_begin(&leader->uthreads); e != list_end(&leader->uthreads);
+         e = list_next(e))
+    {
+        struct uthread *t = list_entry(e, struct uthread, elem);
+
+        if (t->tid == tid && t != cur->uthread)
+        {
+            ut = t;
+            list_remove(&ut->elem);
+            break;
+        }
+    }
+    lock_release(&leader->uthread_lock);
+
+    if (!ut)
+        return TID_ERROR;
+    if (!sema_down_cancelable(&ut->exit_sema))
+    {
+        /* The process is exiting.  Leave UT for the main thread
+         to wait for. */
+        lock_acquire(&leader->uthread_lock);
+        list_push_back(&leader->uthreads, &ut->elem);
+        lock_release(&leader->uthread_lock);
+        return TID_ERROR;
+    }
+    free(ut);
+
+    return tid;
+}
+
+/* Ends the current thread.  The main thread first waits for the
+   process's other threads, then exits the process with status
+   0. */
+void process_thread_exit(void)
+{
+    struct thread *cur = thread_current();
+
+    if (cur->leader == cur)
+    {
+        wait_uthreads(cur);
+        syscall_exit(0);
+    }
+    thread_exit();
+}
+
+/* A thread function that enters user mode in the address space
+   of the process that created it. */
+static void
+start_uthread(void *ut_)
+{
+    struct uthread *ut = ut_;
+    struct thread *cur = thread_current();
+    uint8_t *top = (uint8_t *)PHYS_BASE - ut->slot * UTHREAD_STACK_SIZE;
+    struct intr_frame if_;
+    void **esp;
+
+    /* Share the process's page directory, and through the
+     leader, the rest of its state. */
+    cur->leader = ut->leader;
+    cur->uthread = ut;
+    cur->pagedir = ut->leader->pagedir;
+    process_activate();
+
+    if (ut->leader->exiting || !setup_uthread_stack(top - PGSIZE))
+        thread_exit();
+
+    memset(&if_, 0, sizeof if_);
+    if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
+    if_.cs = SEL_UCSEG;
+    if_.eflags = FLAG_IF | FLAG_MBS;
+    if_.eip = (void (*)(void))ut->eip;
+
+    /* Call EIP(FUNC, AUX) with a null return address. */
+    esp = (void **)top;
+    *--esp = ut->aux;
+    *--esp = ut->func;
+    *--esp = NULL;
+    if_.esp = esp;
+
+    asm volatile("movl %0, %%esp; jmp intr_exit"
+                 :
+                 : "g"(&if_)
+                 : "memory");
+    NOT_REACHED();
+}
+
+/* Makes sure UPAGE, the top page of a thread's user stack, is
+   mapped.  A thread reusing the slot of one that has exited
+   finds its stack still there. */
+static bool
+setup_uthread_stack(void *upage)
+{
+    struct thread *leader = thread_current()->leader;
+    bool success = true;
+
+#ifdef VM
+    lock_acquire(&leader->fault_lock);
+    if (!find_spte(leader, upage))
+        success = grow_stack(upage);
+    lock_release(&leader->fault_lock);
+#else
+    lock_acquire(&leader->uthread_lock);
+    if (pagedir_get_page(leader->pagedir, upage) == NULL)
+    {
+        uint8_t *kpage = palloc_get_page(PAL_USER | PAL_ZERO);
+
+        success = kpage != NULL && install_page(upage, kpage, true);
+        if (!success && kpage != NULL)
+            palloc_free_page(kpage);
+    }
+    lock_release(&leader->uthread_lock);
+#endif
+
+    return success;
+}
+
+/* Wakes up the threads of LEADER's process from the kernel waits
+   that could keep them from noticing that the process is
+   exiting: uthread_join(), wait(), and reads from the console.
+   Each one then exits on its way back to user mode. */
+void process_cancel_waits(struct thread *leader)
+{
+    enum intr_level old_level;
+
+    old_level = intr_disable();
+    thread_foreach(cancel_waits, leader);
+    intr_set_level(old_level);
+}
+
+/* Cancels the waits of thread T if it belongs to the process
+   whose main thread is LEADER_. */
+static void
+cancel_waits(struct thread *t, void *leader_)
+{
+    struct thread *leader = leader_;
+
+    if (t->leader == leader)
+        sema_cancel(t);
+}
+
+/* Waits for the threads of LEADER's process that nobody is
+   joining to exit, including any they create meanwhile. */
+static void
+wait_uthreads(struct thread *leader)
+{
+    lock_acquire(&leader->uthread_lock);
+    while (!list_empty(&leader->uthreads))
+    {
+        struct uthread *ut = list_entry(list_pop_front(&leader->uthreads),
+                                        struct uthread, elem);
+
+        lock_release(&leader->uthread_lock);
+        sema_down(&ut->exit_sema);
+        free(ut);
+        lock_acquire(&leader->uthread_lock);
+    }
+    lock_release(&leader->uthread_lock);
+}
+
+/* Frees the current thread's part of its process, which is not
+   the main thread: just its user stack slot.  The stack's pages
+   stay mapped for the next thread in the slot. */
+static void
+exit_uthread(void)
+{
+    struct thread *cur = thread_current();
+    struct thread *leader = cur->leader;
+    struct uthread *ut = cur->uthread;
+
+    /* Stop using the page directory before the leader can
+     destroy it. */
+    cur->pagedir = NULL;
+    pagedir_activate(NULL);
+
+    lock_acquire(&leader->uthread_lock);
+    leader->uthread_slots &= ~(1u << ut->slot);
+    lock_release(&leader->uthread_lock);
+
+    /* UT, and LEADER once every thread is done, may be freed as
+     soon as this is up. */
+    sema_up(&ut->exit_sema);
+}
+
 /* Sets up the CPU for running user code in the current
    thread.
    This function is called on every context switch. */
@@ -228,8 +518,10 @@ void process_activate(void)
     tss_update();
 }
 
-/* Returns the current process's child process with pid PID. */
-struct process *process_get_child(pid_t pid)
+/* Returns the current process's child process with pid PID.
+   The process's children_lock must be held. */
+static struct process *
+get_child(pid_t pid)
 {
     struct list *children = thread_get_children();
     struct list_elem *e;
@@ -246,8 +538,10 @@ struct process *process_get_child(pid_t pid)
 }
 
 /* Removes CHILD from the current process's children list and
-   reset its parent. If it is terminated, free its page. */
-void process_remove_child(struct process *child)
+   reset its parent. If it is terminated, free its page.  The
+   process's children_lock must be held. */
+static void
+remove_child(struct process *child)
 {
     if (!child)
         return;
@@ -259,12 +553,17 @@ void process_remove_child(struct process *child)
         palloc_free_page(child);
 }
 
-/* Returns the current process's file descriptor entry with fd FD. */
+/* Returns the current process's file descriptor entry with fd
+   FD.  The file system lock, which also protects the process's
+   fd table, must be held until the caller is done with the
+   entry, so that another thread cannot close it meanwhile. */
 struct file_descriptor_entry *process_get_fde(int fd)
 {
     struct list *fdt = thread_get_fdt();
     struct list_elem *e;
 
+    ASSERT(lock_held_by_current_thread(syscall_get_filesys_lock()));
+
     for (e = list_begin(fdt); e != list_end(fdt); e = list_next(e))
     {
         struct file_descriptor_entry *fde = list_entry(e, struct file_descriptor_entry, fdtelem);
@@ -461,8 +760,6 @@ done:
 
 /* load() helpers. */
 
-static bool install_page(void *upage, void *kpage, bool writable);
-
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
 static bool
@@ -7,7 +7,13 @@
 
 #define MAX_ARGS 128
 
-struct lock vm_destroy_lock;
+/* Threads per process, counting its main thread, and the user
+   stack space each one gets.  Together they fill the 8 MB stack
+   area below PHYS_BASE, the main thread's at the top. */
+#define UTHREAD_MAX 8
+#define UTHREAD_STACK_SIZE (0x800000 / UTHREAD_MAX)
+
+extern struct lock vm_destroy_lock;
 
 /* A process control block. */
 struct process
@@ -22,10 +28,25 @@ struct process
     bool is_loaded;             /* Whether program is loaded. */
     struct semaphore load_sema; /* Semaphore for waiting until load. */
     bool is_exited;             /* Whether process is exited. */
+    bool is_waited;             /* Whether a thread waits for it. */
     struct semaphore exit_sema; /* Semaphore for waiting until exit. */
     int exit_status;            /* Exit status. */
 };
 
+/* A thread of a process other than its main thread. */
+struct uthread
+{
+    /* Owned by process.c. */
+    tid_t tid;                  /* Thread identifier. */
+    struct thread *leader;      /* Main thread of the process. */
+    int slot;                   /* User stack slot. */
+    void *eip;                  /* User entry point. */
+    void *func;                 /* First argument for EIP. */
+    void *aux;                  /* Second argument for EIP. */
+    struct semaphore exit_sema; /* Semaphore for waiting until exit. */
+    struct list_elem elem;      /* List element for leader's uthreads. */
+};
+
 /* A file descriptor entry. */
 struct file_descriptor_entry
 {
@@ -39,8 +60,11 @@ int process_wait(tid_t);
 void process_exit(void);
 void process_activate(void);
 
-struct process *process_get_child(pid_t);
-void process_remove_child(struct process *);
+tid_t process_thread_create(void *eip, void *func, void *aux);
+tid_t process_thread_join(tid_t);
+void process_thread_exit(void) NO_RETURN;
+void process_cancel_waits(struct thread *leader);
+
 struct file_descriptor_entry *process_get_fde(int);
 
 #endif /* userprog/process.h */
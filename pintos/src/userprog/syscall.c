@@ -1,4 +1,5 @@
 #include "userprog/syscall.h"
+#include <hash.h>
 #include <stdio.h>
 #include <syscall-nr.h>
 #include "devices/input.h"
@@ -14,9 +15,32 @@
 #include "threads/malloc.h"
 #include "userprog/pagedir.h"
 #include "userprog/process.h"
+#include "vm/frame.h"
 
 struct lock filesys_lock;
-void* esp;
+
+/* Futexes with waiters, by the kernel virtual address of the
+   word waited on.  That is the word's physical address, which
+   every thread mapping its frame agrees on, so waiters' frames
+   are pinned until they wake up. */
+static struct hash futexes;
+static struct lock futex_lock;
+
+/* Threads waiting on one futex word. */
+struct futex
+{
+    void *key;             /* Kernel virtual address of the word. */
+    struct list waiters;   /* List of futex_waiters, in order. */
+    struct hash_elem elem; /* Element in futexes. */
+};
+
+/* A thread in futex_wait(). */
+struct futex_waiter
+{
+    struct thread *leader; /* Main thread of its process. */
+    struct semaphore sema; /* Upped to wake it up. */
+    struct list_elem elem; /* Element in the futex's waiters. */
+};
 
 static void syscall_handler(struct intr_frame *);
 
@@ -34,6 +58,14 @@ static int syscall_write(int, const void *, unsigned);
 static void syscall_seek(int, unsigned);
 static unsigned syscall_tell(int);
 static mapid_t syscall_mmap (int, void*);
+static int syscall_futex_wait(int *, int);
+static int syscall_futex_wake(int *, int);
+
+static hash_hash_func futex_hash;
+static hash_less_func futex_less;
+static void *pin_futex(int *);
+static struct futex *find_futex(void *key);
+static void wake_futexes(struct thread *leader);
 
 struct mmap_table_entry* find_mmap_table_entry(struct thread*, mapid_t);
 
@@ -42,6 +74,8 @@ void syscall_init(void)
 {
     intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall");
     lock_init(&filesys_lock);
+    hash_init(&futexes, futex_hash, futex_less, NULL);
+    lock_init(&futex_lock);
 }
 
 /* Pops the system call number and handles system call
@@ -49,10 +83,13 @@ void syscall_init(void)
 static void
 syscall_handler(struct intr_frame *f)
 {
-    // void *esp = f->esp;
-    esp = f->esp;
+    void *esp = f->esp;
     int syscall_num;
 
+    /* Another thread has exited the process. */
+    if (thread_current()->leader->exiting)
+        thread_exit();
+
     check_vaddr(esp);
     check_vaddr(esp + sizeof(uintptr_t) - 1);
     syscall_num = *(int *)esp;
@@ -232,6 +269,62 @@ syscall_handler(struct intr_frame *f)
         syscall_munmap (mapping);
         break;
     }
+    case SYS_THREAD_CREATE:
+    {
+        void *eip, *func, *aux;
+
+        check_vaddr(esp + sizeof(uintptr_t));
+        check_vaddr(esp + 4 * sizeof(uintptr_t) - 1);
+        eip = *(void **)(esp + sizeof(uintptr_t));
+        func = *(void **)(esp + 2 * sizeof(uintptr_t));
+        aux = *(void **)(esp + 3 * sizeof(uintptr_t));
+
+        check_vaddr(eip);
+        f->eax = (uint32_t)process_thread_create(eip, func, aux);
+        break;
+    }
+    case SYS_THREAD_EXIT:
+    {
+        process_thread_exit();
+        NOT_REACHED();
+    }
+    case SYS_THREAD_JOIN:
+    {
+        tid_t tid;
+
+        check_vaddr(esp + sizeof(uintptr_t));
+        check_vaddr(esp + 2 * sizeof(uintptr_t) - 1);
+        tid = *(tid_t *)(esp + sizeof(uintptr_t));
+
+        f->eax = (uint32_t)process_thread_join(tid);
+        break;
+    }
+    case SYS_FUTEX_WAIT:
+    {
+        int *addr;
+        int expected;
+
+        check_vaddr(esp + sizeof(uintptr_t));
+        check_vaddr(esp + 3 * sizeof(uintptr_t) - 1);
+        addr = *(int **)(esp + sizeof(uintptr_t));
+        expected = *(int *)(esp + 2 * sizeof(uintptr_t));
+
+        f->eax = (uint32_t)syscall_futex_wait(addr, expected);
+        break;
+    }
+    case SYS_FUTEX_WAKE:
+    {
+        int *addr;
+        int n;
+
+        check_vaddr(esp + sizeof(uintptr_t));
+        check_vaddr(esp + 3 * sizeof(uintptr_t) - 1);
+        addr = *(int **)(esp + sizeof(uintptr_t));
+        n = *(int *)(esp + 2 * sizeof(uintptr_t));
+
+        f->eax = (uint32_t)syscall_futex_wake(addr, n);
+        break;
+    }
     default:
         syscall_exit(-1);
     }
@@ -257,11 +350,16 @@ static void syscall_halt(void)
     shutdown_power_off();
 }
 
-/* Handles exit() system call. */
+/* Handles exit() system call.  The process's other threads are
+   woken from their waits and exit before they next return to
+   user mode. */
 void syscall_exit(int status)
 {
     struct process *pcb = thread_get_pcb();
 
+    thread_current()->leader->exiting = true;
+    wake_futexes(thread_current()->leader);
+    process_cancel_waits(thread_current()->leader);
     pcb->exit_status = status;
     printf("%s: exit(%d)\n", thread_name(), status);
     thread_exit();
@@ -271,7 +369,6 @@ void syscall_exit(int status)
 static pid_t syscall_exec(const char *cmd_line)
 {
     pid_t pid;
-    struct process *child;
     int i;
 
     check_vaddr(cmd_line);
@@ -279,12 +376,8 @@ static pid_t syscall_exec(const char *cmd_line)
         check_vaddr(cmd_line + i + 1);
 
     pid = process_execute(cmd_line);
-    child = process_get_child(pid);
 
-    if (!child || !child->is_loaded)
-        return PID_ERROR;
-
-    return pid;
+    return pid == TID_ERROR ? PID_ERROR : pid;
 }
 
 /* Handles wait() system call. */
@@ -365,14 +458,13 @@ static int syscall_open(const char *file)
 /* Handles filesize() system call. */
 static int syscall_filesize(int fd)
 {
-    struct file_descriptor_entry *fde = process_get_fde(fd);
-    int filesize;
-
-    if (!fde)
-        return -1;
+    struct file_descriptor_entry *fde;
+    int filesize = -1;
 
     lock_acquire(&filesys_lock);
-    filesize = file_length(fde->file);
+    fde = process_get_fde(fd);
+    if (fde)
+        filesize = file_length(fde->file);
     lock_release(&filesys_lock);
 
     return filesize;
@@ -392,18 +484,17 @@ static int syscall_read(int fd, void *buffer, unsigned size)
     {
         unsigned i;
 
+        /* Stop early if another thread exits the process. */
         for (i = 0; i < size; i++)
-            *(uint8_t *)(buffer + i) = input_getc();
+            if (!input_getc_cancelable((uint8_t *)(buffer + i)))
+                break;
 
-        return size;
+        return i;
     }
 
-    fde = process_get_fde(fd);
-    if (!fde)
-        return -1;
-
     lock_acquire(&filesys_lock);
-    bytes_read = (int)file_read(fde->file, buffer, (off_t)size);
+    fde = process_get_fde(fd);
+    bytes_read = fde ? (int)file_read(fde->file, buffer, (off_t)size) : -1;
     lock_release(&filesys_lock);
 
     return bytes_read;
@@ -425,12 +516,9 @@ static int syscall_write(int fd, const void *buffer, unsigned size)
         return size;
     }
 
-    fde = process_get_fde(fd);
-    if (!fde)
-        return -1;
-
     lock_acquire(&filesys_lock);
-    bytes_written = (int)file_write(fde->file, buffer, (off_t)size);
+    fde = process_get_fde(fd);
+    bytes_written = fde ? (int)file_write(fde->file, buffer, (off_t)size) : -1;
     lock_release(&filesys_lock);
 
     return bytes_written;
@@ -439,27 +527,25 @@ static int syscall_write(int fd, const void *buffer, unsigned size)
 /* Handles seek() system call. */
 static void syscall_seek(int fd, unsigned position)
 {
-    struct file_descriptor_entry *fde = process_get_fde(fd);
-
-    if (!fde)
-        return;
+    struct file_descriptor_entry *fde;
 
     lock_acquire(&filesys_lock);
-    file_seek(fde->file, (off_t)position);
+    fde = process_get_fde(fd);
+    if (fde)
+        file_seek(fde->file, (off_t)position);
     lock_release(&filesys_lock);
 }
 
 /* Handles tell() system call. */
 static unsigned syscall_tell(int fd)
 {
-    struct file_descriptor_entry *fde = process_get_fde(fd);
-    unsigned pos;
-
-    if (!fde)
-        return -1;
+    struct file_descriptor_entry *fde;
+    unsigned pos = -1;
 
     lock_acquire(&filesys_lock);
-    pos = (unsigned)file_tell(fde->file);
+    fde = process_get_fde(fd);
+    if (fde)
+        pos = (unsigned)file_tell(fde->file);
     lock_release(&filesys_lock);
 
     return pos;
@@ -468,15 +554,16 @@ static unsigned syscall_tell(int fd)
 /* Handles close() system call. */
 void syscall_close(int fd)
 {
-    struct file_descriptor_entry *fde = process_get_fde(fd);
-
-    if (!fde)
-        return;
+    struct file_descriptor_entry *fde;
 
     lock_acquire(&filesys_lock);
-    file_close(fde->file);
-    list_remove(&fde->fdtelem);
-    palloc_free_page(fde);
+    fde = process_get_fde(fd);
+    if (fde)
+    {
+        file_close(fde->file);
+        list_remove(&fde->fdtelem);
+        palloc_free_page(fde);
+    }
     lock_release(&filesys_lock);
 }
 
@@ -485,7 +572,7 @@ mapid_t syscall_mmap (int fd, void* addr) {
     off_t len, position;
     struct supplemental_page_table_entry* spte, hash_finder;
     struct hash_elem* found_elem;
-    struct thread* t = thread_current ();
+    struct thread* t = thread_current ()->leader;
     struct file* fp;
     struct mmap_table_entry* mte;
     uint32_t read_bytes, zero_bytes;
@@ -500,19 +587,23 @@ mapid_t syscall_mmap (int fd, void* addr) {
         return -1;
     }
 
+    /* Reopen the file while FD is sure to stay open. */
+    lock_acquire (&filesys_lock);
     fde = process_get_fde (fd);
+    fp = fde ? file_reopen (fde->file) : NULL;
+    len = fp ? file_length (fp) : 0;
+    lock_release (&filesys_lock);
 
     /* No such file descriptor? */
-    if (!fde) {
+    if (!fp) {
         return -1;
     }
 
-    lock_acquire (&filesys_lock);
-    len = file_length (fde->file);
-    lock_release (&filesys_lock);
-
     /* Zero length? */
     if (len == 0) {
+        lock_acquire (&filesys_lock);
+        file_close (fp);
+        lock_release (&filesys_lock);
         return -1;
     }
 
@@ -521,14 +612,13 @@ mapid_t syscall_mmap (int fd, void* addr) {
         spte = find_spte (t, addr + position);
 
         if (spte) {
+            lock_acquire (&filesys_lock);
+            file_close (fp);
+            lock_release (&filesys_lock);
             return -1;
         }
     }
 
-    lock_acquire (&filesys_lock);
-    fp = file_reopen (fde->file);
-    lock_release (&filesys_lock);
-
     mte = (struct mmap_table_entry*)malloc (sizeof (struct mmap_table_entry));
 
     ASSERT (mte != NULL);
@@ -552,7 +642,7 @@ mapid_t syscall_mmap (int fd, void* addr) {
 
 void syscall_munmap (mapid_t mapping) {
     off_t len, position;
-    struct thread* t = thread_current ();
+    struct thread* t = thread_current ()->leader;
     struct mmap_table_entry* mte;
     struct hash_elem* elem;
     struct supplemental_page_table_entry* spte_finder, *spte;
@@ -605,4 +695,198 @@ struct mmap_table_entry* find_mmap_table_entry(struct thread* t, mapid_t mapping
     }
 
     return NULL;
-}
\ No newline at end of file
+}
+
+/* Handles futex_wait() system call: sleeps until woken up by
+   futex_wake() on ADDR, if the word at ADDR is EXPECTED.  Returns
+   0 after being woken up, or -1 right away if the word differs
+   or ADDR is not word-aligned. */
+static int syscall_futex_wait(int *addr, int expected)
+{
+    struct thread *leader = thread_current()->leader;
+    struct futex_waiter waiter;
+    struct futex *futex;
+    void *key;
+
+    if ((uintptr_t)addr % sizeof(int) != 0)
+        return -1;
+    check_vaddr(addr);
+
+    /* Comparing and queuing under futex_lock means a futex_wake()
+     that follows a change of the word cannot be missed. */
+    key = pin_futex(addr);
+    lock_acquire(&futex_lock);
+    futex = find_futex(key);
+    if (!futex && !leader->exiting && *(int *)key == expected)
+    {
+        futex = malloc(sizeof *futex);
+        if (futex)
+        {
+            futex->key = key;
+            list_init(&futex->waiters);
+            hash_insert(&futexes, &futex->elem);
+        }
+    }
+    if (!futex || leader->exiting || *(int *)key != expected)
+    {
+        lock_release(&futex_lock);
+        unpin_frame_entry(pg_round_down(key));
+        return -1;
+    }
+    waiter.leader = leader;
+    sema_init(&waiter.sema, 0);
+    list_push_back(&futex->waiters, &waiter.elem);
+    lock_release(&futex_lock);
+
+    sema_down(&waiter.sema);
+    unpin_frame_entry(pg_round_down(key));
+    if (leader->exiting)
+        thread_exit();
+
+    return 0;
+}
+
+/* Handles futex_wake() system call: wakes up to N threads
+   waiting on ADDR, oldest first, and returns how many it woke
+   up, or -1 if ADDR is not word-aligned. */
+static int syscall_futex_wake(int *addr, int n)
+{
+    struct futex *futex;
+    void *key;
+    int woken = 0;
+
+    if ((uintptr_t)addr % sizeof(int) != 0)
+        return -1;
+    check_vaddr(addr);
+
+    /* A page that is not present has no waiters, since they pin
+     it. */
+    key = pagedir_get_page(thread_current()->pagedir, addr);
+    if (!key)
+        return 0;
+
+    lock_acquire(&futex_lock);
+    futex = find_futex(key);
+    if (futex)
+    {
+        while (woken < n && !list_empty(&futex->waiters))
+        {
+            struct futex_waiter *w = list_entry(list_pop_front(&futex->waiters),
+                                                struct futex_waiter, elem);
+
+            sema_up(&w->sema);
+            woken++;
+        }
+        if (list_empty(&futex->waiters))
+        {
+            hash_delete(&futexes, &futex->elem);
+            free(futex);
+        }
+    }
+    lock_release(&futex_lock);
+
+    return woken;
+}
+
+/* Brings in the page of user word ADDR and pins its frame.
+   Returns the word's kernel virtual address. */
+static void *
+pin_futex(int *addr)
+{
+    uint32_t *pd = thread_current()->pagedir;
+
+    for (;;)
+    {
+        void *key;
+
+        /* Fault the page in, or exit if ADDR is not mapped. */
+        (void)*(volatile int *)addr;
+
+        /* The frame may be evicted before it is pinned, so
+         check that the word is still there afterward. */
+        key = pagedir_get_page(pd, addr);
+        if (key && pin_frame_entry(pg_round_down(key)))
+        {
+            if (pagedir_get_page(pd, addr) == key)
+                return key;
+            unpin_frame_entry(pg_round_down(key));
+        }
+    }
+}
+
+/* Returns the futex for KEY, or a null pointer if nothing waits
+   on it.  futex_lock must be held. */
+static struct futex *
+find_futex(void *key)
+{
+    struct futex finder;
+    struct hash_elem *e;
+
+    finder.key = key;
+    e = hash_find(&futexes, &finder.elem);
+    return e ? hash_entry(e, struct futex, elem) : NULL;
+}
+
+/* Wakes up the threads of LEADER's process waiting on futexes,
+   so that they can exit with it. */
+static void
+wake_futexes(struct thread *leader)
+{
+    bool deleted;
+
+    lock_acquire(&futex_lock);
+    do
+    {
+        struct hash_iterator i;
+
+        /* Deleting a futex ends the iteration, so start over
+         after each one. */
+        deleted = false;
+        hash_first(&i, &futexes);
+        while (!deleted && hash_next(&i))
+        {
+            struct futex *futex = hash_entry(hash_cur(&i), struct futex, elem);
+            struct list_elem *e;
+
+            for (e = list_begin(&futex->waiters); e != list_end(&futex->waiters);)
+            {
+                struct futex_waiter *w = list_entry(e, struct futex_waiter, elem);
+
+                if (w->leader == leader)
+                {
+                    e = list_remove(e);
+                    sema_up(&w->sema);
+                }
+                else
+                    e = list_next(e);
+            }
+            if (list_empty(&futex->waiters))
+            {
+                hash_delete(&futexes, &futex->elem);
+                free(futex);
+                deleted = true;
+            }
+        }
+    } while (deleted);
+    lock_release(&futex_lock);
+}
+
+/* Returns a hash value for futex F_. */
+static unsigned
+futex_hash(const struct hash_elem *f_, void *aux UNUSED)
+{
+    const struct futex *f = hash_entry(f_, struct futex, elem);
+
+    return hash_bytes(&f->key, sizeof f->key);
+}
+
+/* Returns true if futex A precedes futex B. */
+static bool
+futex_less(const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+    const struct futex *a = hash_entry(a_, struct futex, elem);
+    const struct futex *b = hash_entry(b_, struct futex, elem);
+
+    return a->key < b->key;
+}
@@ -19,6 +19,7 @@ struct frame_table_entry {
     void* upage;   /* Virtual address. */
     void* kpage;   /* Physical address. */
     struct thread* owner;   /* Which process is owning this frame? */
+    int pin_cnt;            /* Never evicted while nonzero. */
     struct list_elem elem;
 };
 
@@ -100,7 +101,10 @@ void* alloc_frame_entry (enum palloc_flags flags, uint8_t* upage) {
         fte = victim;
     }
 
-    fte->owner = thread_current ();
+    /* Threads of a process share its address space through the
+       leader, which outlives them. */
+    fte->owner = thread_current ()->leader;
+    fte->pin_cnt = 0;
     if (!is_eviction) {
         fte->kpage = frame;
     }
@@ -142,6 +146,45 @@ void free_frame_entry (void* kpage) {
     palloc_free_page (kpage);
 }
 
+/* Pins the frame at KPAGE, so that it is not evicted until
+   unpinned as many times.  Returns false if KPAGE is not in the
+   frame table. */
+bool pin_frame_entry (void* kpage) {
+    struct frame_table_entry* fte;
+    struct list_elem* e;
+    bool found = false;
+
+    lock_acquire (&frame_table_lock);
+    for (e = list_begin (&frame_table); e != list_end (&frame_table); e = list_next (e)) {
+        fte = list_entry (e, struct frame_table_entry, elem);
+        if (fte->kpage == kpage) {
+            fte->pin_cnt++;
+            found = true;
+            break;
+        }
+    }
+    lock_release (&frame_table_lock);
+
+    return found;
+}
+
+/* Undoes one pin_frame_entry() of the frame at KPAGE. */
+void unpin_frame_entry (void* kpage) {
+    struct frame_table_entry* fte;
+    struct list_elem* e;
+
+    lock_acquire (&frame_table_lock);
+    for (e = list_begin (&frame_table); e != list_end (&frame_table); e = list_next (e)) {
+        fte = list_entry (e, struct frame_table_entry, elem);
+        if (fte->kpage == kpage) {
+            ASSERT (fte->pin_cnt > 0);
+            fte->pin_cnt--;
+            break;
+        }
+    }
+    lock_release (&frame_table_lock);
+}
+
 /* Select victim based on clock algorithm. */
 static struct frame_table_entry* get_victim () {
     struct frame_table_entry* victim;
@@ -153,7 +196,10 @@ static struct frame_table_entry* get_victim () {
     }
 
     while (1) {
-        if (pagedir_is_accessed (clock_pointer->owner->pagedir, clock_pointer->upage)) {
+        if (clock_pointer->pin_cnt > 0) {
+            /* Pinned: skip. */
+        }
+        else if (pagedir_is_accessed (clock_pointer->owner->pagedir, clock_pointer->upage)) {
             pagedir_set_accessed (clock_pointer->owner->pagedir, clock_pointer->upage, false);
         }
         else {
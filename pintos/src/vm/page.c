@@ -112,9 +112,9 @@ bool load_file_page (struct supplemental_page_table_entry* spte) {
     }
 }
 
-void grow_stack (void* fault_addr) {
+bool grow_stack (void* fault_addr) {
     void* frame;
-    struct thread* t = thread_current ();
+    struct thread* t = thread_current ()->leader;
     bool success;
 
     frame = alloc_frame_entry ((PAL_USER | PAL_ZERO), pg_round_down (fault_addr));
@@ -122,10 +122,11 @@ void grow_stack (void* fault_addr) {
     success = pagedir_set_page (t->pagedir, pg_round_down (fault_addr), frame, true);
     if (success) {
         insert_unmapped_spte (t, NULL, 0, pg_round_down (fault_addr), frame, 0, 0, true, 1, false);
-        return;
+        return true;
     }
     else {
         free_frame_entry (frame);
+        return false;
     }
 }
 
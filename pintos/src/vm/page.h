@@ -38,7 +38,7 @@ bool insert_unmapped_spte (struct thread* t, struct file* file, off_t ofs, void*
 bool load_file_page (struct supplemental_page_table_entry*);
 
 /* Grow stack. */
-void grow_stack (void* fault_addr);
+bool grow_stack (void* fault_addr);
 
 /* Find supplemental page table entry using virtual address. */
 struct supplemental_page_table_entry* find_spte (struct thread*, void*);